@@ -0,0 +1,531 @@
+#pragma once
+
+#include <ulib/yaml.h>
+#include <yaml-cpp/yaml.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// differential checks of the parse paths against a tree built from YAML::Load, shared by the fuzz target and
+// the tests. every path has to accept the same inputs as the reference and build an equal tree with equal
+// output, so a fast path can't drift from the yaml-cpp conversion unnoticed
+namespace yaml_fuzz
+{
+    // the input uses a feature the ulib tree doesn't represent, e.g. a collection key
+    class unsupported : public std::runtime_error
+    {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    enum class path_t
+    {
+        reference, // YAML::Load converted node by node
+        parse,     // yaml::parse(), including the JSON reader dispatch
+        json,      // yaml::parse_json(), inputs it accepts
+        lazy,      // parse_options::lazy, every value accessed
+        stream,    // stream_parser fed in small chunks
+        columnar,  // parse_options::columnar from two rows, with and without preserve_style
+        count,
+    };
+
+    inline const char *path_name(path_t path)
+    {
+        switch (path)
+        {
+        case path_t::reference: return "reference";
+        case path_t::parse: return "parse";
+        case path_t::json: return "parse_json";
+        case path_t::lazy: return "lazy";
+        case path_t::stream: return "stream";
+        case path_t::columnar: return "columnar";
+        default: return "?";
+        }
+    }
+
+    // time spent per path over a class of inputs
+    struct timings
+    {
+        double seconds[size_t(path_t::count)] = {};
+        size_t bytes = 0;
+        size_t inputs = 0;
+    };
+
+    namespace detail
+    {
+        inline ulib::yaml convert(const YAML::Node &node, size_t &budget, size_t depth = 0)
+        {
+            // aliases share nodes in YAML::Node, the conversion expands them. an alias inside its own anchor
+            // makes a cycle
+            if (budget-- == 0 || depth > 256)
+                throw unsupported{"alias expansion exceeds the budget"};
+
+            switch (node.Type())
+            {
+            case YAML::NodeType::Null:
+                return ulib::yaml{};
+
+            case YAML::NodeType::Scalar:
+                return ulib::yaml{ulib::string{node.Scalar()}};
+
+            case YAML::NodeType::Sequence: {
+                ulib::yaml out = ulib::yaml::sequence();
+                for (const auto &child : node)
+                    out.push_back(convert(child, budget, depth + 1));
+                return out;
+            }
+
+            case YAML::NodeType::Map: {
+                ulib::yaml out = ulib::yaml::map();
+                for (const auto &item : node)
+                {
+                    if (!item.first.IsScalar() && !item.first.IsNull())
+                        throw unsupported{"collection key"};
+
+                    // the last of duplicate keys wins, at the position of the first. a null key reads as "null"
+                    out[ulib::string{item.first.as<std::string>()}] = convert(item.second, budget, depth + 1);
+                }
+                return out;
+            }
+
+            default:
+                throw unsupported{"undefined node"};
+            }
+        }
+
+        template <class FnT>
+        auto timed(timings *times, path_t path, FnT &&fn)
+        {
+            auto start = std::chrono::steady_clock::now();
+            struct stop
+            {
+                timings *times;
+                path_t path;
+                std::chrono::steady_clock::time_point start;
+                ~stop()
+                {
+                    if (times)
+                        times->seconds[size_t(path)] +=
+                            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                }
+            } guard{times, path, start};
+
+            return fn();
+        }
+    } // namespace detail
+
+    inline ulib::yaml reference_parse(const std::string &text)
+    {
+        size_t budget = size_t(1) << 20;
+        return detail::convert(YAML::Load(text), budget);
+    }
+
+    // empty if every path agrees with the reference, else what differs. seed picks the stream chunk sizes
+    inline std::string check(const std::string &text, timings *times = nullptr, uint64_t seed = 0)
+    {
+        if (times)
+        {
+            times->bytes += text.size();
+            times->inputs++;
+        }
+
+        ulib::yaml reference;
+        bool accepted = true;
+        try
+        {
+            reference = detail::timed(times, path_t::reference, [&] { return reference_parse(text); });
+        }
+        catch (const unsupported &)
+        {
+            accepted = false;
+        }
+        catch (const YAML::Exception &)
+        {
+            accepted = false;
+        }
+
+        ulib::string_view view{text.data(), text.size()};
+
+        // the JSON reader is stricter than YAML, only what it accepts has to agree with it. yaml-cpp rejects some
+        // valid JSON, e.g. surrogate pair escapes, there the JSON reader's tree is the reference
+        bool json = false;
+        try
+        {
+            ulib::yaml tree = ulib::yaml::parse_json(view);
+            json = true;
+
+            if (!accepted)
+                reference = std::move(tree), accepted = true;
+        }
+        catch (const ulib::yaml::parse_error &)
+        {
+        }
+
+        ulib::yaml::dump_options canonical;
+        canonical.canonical = true;
+
+        std::string referenceDump;
+        if (accepted)
+        {
+            auto dump = reference.dump(canonical);
+            referenceDump.assign(dump.data(), dump.size());
+        }
+
+        // compares the tree and the output, lazy values are parsed here and throw here. the entry paths read one
+        // top-level entry at a time, yaml-cpp rejects some entries only for what follows them, e.g. a multi-line
+        // plain key before another key. they may accept what the reference rejects, never build another tree
+        auto agree = [&](path_t path, auto &&parse) -> std::string {
+            std::string name = path_name(path);
+            bool entries = path == path_t::lazy || path == path_t::stream;
+            try
+            {
+                ulib::yaml out = detail::timed(times, path, parse);
+
+                // writing it out reaches every value
+                auto dump = out.dump(canonical);
+                if (!accepted && entries)
+                    return {};
+                if (!accepted)
+                    return name + " accepts input the reference rejects";
+
+                if (!(out == reference))
+                    return name + " builds a different tree";
+
+                if (std::string{dump.data(), dump.size()} != referenceDump)
+                    return name + " dumps different output";
+            }
+            catch (const std::exception &error)
+            {
+                if (accepted)
+                    return name + " rejects input the reference accepts: " + error.what();
+            }
+
+            return {};
+        };
+
+        std::string diff = agree(path_t::parse, [&] { return ulib::yaml::parse(view); });
+        if (!diff.empty())
+            return diff;
+
+        if (json && !(diff = agree(path_t::json, [&] { return ulib::yaml::parse_json(view); })).empty())
+            return diff;
+
+        ulib::yaml::parse_options lazy;
+        lazy.lazy = true;
+        if (!(diff = agree(path_t::lazy, [&] { return ulib::yaml::parse(view, lazy); })).empty())
+            return diff;
+
+        diff = agree(path_t::stream, [&] {
+            std::mt19937_64 rng{seed};
+            ulib::yaml::stream_parser parser;
+            for (size_t at = 0; at < text.size();)
+            {
+                size_t size = std::min<size_t>(1 + rng() % 64, text.size() - at);
+                parser.feed(ulib::string_view{text.data() + at, size});
+                at += size;
+            }
+            return parser.finish();
+        });
+        if (!diff.empty())
+            return diff;
+
+        // record sequences are stored as tables, everything else the way parse() stores it
+        ulib::yaml::parse_options columnar;
+        columnar.columnar = true;
+        columnar.columnar_min_rows = 2;
+        if (!(diff = agree(path_t::columnar, [&] { return ulib::yaml::parse(view, columnar); })).empty())
+            return diff;
+
+        columnar.preserve_style = true;
+        if (!(diff = agree(path_t::columnar, [&] { return ulib::yaml::parse(view, columnar); })).empty())
+            return diff;
+
+        // block output with anchors reads back as the same tree
+        if (accepted)
+        {
+            auto dump = reference.dump();
+            try
+            {
+                if (!(ulib::yaml::parse(dump) == reference))
+                    return "dump() doesn't read back as the same tree";
+            }
+            catch (const std::exception &error)
+            {
+                return std::string{"dump() doesn't read back: "} + error.what();
+            }
+        }
+
+        return {};
+    }
+
+    // random documents from a small grammar, and mutations of them. the same seed gives the same inputs
+    class generator
+    {
+    public:
+        explicit generator(uint64_t seed) : mRng(seed) {}
+
+        // block map or sequence with nested block and flow collections, anchors, quoted and block scalars
+        std::string block()
+        {
+            mAnchors = 0;
+            std::string out;
+            if (below(4) == 0)
+                out += "# header\n---\n";
+
+            block_collection(out, 0, 0, below(3) != 0);
+            return out;
+        }
+
+        std::string flow()
+        {
+            mAnchors = 0;
+            std::string out;
+            flow_node(out, 0, false);
+            return out;
+        }
+
+        std::string json()
+        {
+            std::string out;
+            flow_node(out, 0, true);
+            return out;
+        }
+
+        // a sequence of maps with the same keys, in block, flow or JSON form. some records have no keys, and
+        // some break the pattern with a missing, extra or reordered key or a collection value
+        std::string records()
+        {
+            static const char *const kKeys[] = {"id", "name", "x", "12", "\"quoted key\""};
+            static const char *const kJsonScalars[] = {"1", "-0.5", "2e10", "true", "null", "\"s\"", "\"a: b\""};
+
+            mAnchors = 0;
+            size_t form = below(3);
+            bool json = form == 2;
+            size_t width = below(4);
+
+            auto key = [&](size_t i) {
+                std::string name = kKeys[i];
+                return json && name[0] != '"' ? "\"" + name + "\"" : name;
+            };
+
+            auto value = [&] {
+                if (below(12) == 0)
+                    return std::string{json ? "[1]" : "{v: 1}"};
+
+                return json ? std::string{pick(kJsonScalars)} : scalar(true);
+            };
+
+            std::string out = form == 0 ? "" : "[";
+            for (size_t row = 0, rows = 1 + below(20); row != rows; row++)
+            {
+                // most records follow the first one
+                std::vector<size_t> fields;
+                for (size_t i = 0; i != width; i++)
+                    fields.push_back(i);
+
+                switch (below(16))
+                {
+                case 0:
+                    if (!fields.empty())
+                        fields.pop_back();
+                    break;
+                case 1:
+                    fields.push_back(4);
+                    break;
+                case 2:
+                    if (fields.size() > 1)
+                        std::swap(fields[0], fields[1]);
+                    break;
+                default:
+                    break;
+                }
+
+                if (form == 0)
+                    out += "- ";
+                else if (row != 0)
+                    out += ", ";
+
+                out += "{";
+                for (size_t i = 0; i != fields.size(); i++)
+                    out += (i != 0 ? ", " : "") + key(fields[i]) + ": " + value();
+                out += "}";
+
+                if (form == 0)
+                    out += "\n";
+            }
+
+            if (form != 0)
+                out += "]";
+            return out;
+        }
+
+        // bytes replaced, removed, duplicated or inserted
+        std::string mutate(std::string text)
+        {
+            static const char kBytes[] = " :-?[]{},#&*!|>'\"\n\t\\a0.~";
+
+            for (size_t i = 0, count = 1 + below(4); i != count; i++)
+            {
+                size_t at = text.empty() ? 0 : below(text.size());
+                size_t size = std::min(text.size() - at, 1 + below(8));
+
+                switch (below(4))
+                {
+                case 0:
+                    if (at != text.size())
+                        text[at] = kBytes[below(sizeof(kBytes) - 1)];
+                    break;
+                case 1:
+                    text.erase(at, size);
+                    break;
+                case 2:
+                    text.insert(at, text.substr(at, size));
+                    break;
+                default:
+                    text.insert(at, 1, kBytes[below(sizeof(kBytes) - 1)]);
+                    break;
+                }
+            }
+
+            return text;
+        }
+
+    private:
+        size_t below(size_t n) { return size_t(mRng() % n); }
+
+        template <size_t N>
+        const char *pick(const char *const (&words)[N])
+        {
+            return words[below(N)];
+        }
+
+        std::string scalar(bool flow)
+        {
+            static const char *const kPlain[] = {"a",   "value", "12",    "-3.5", "true", "null", "~",
+                                                 "x y", "1e3",   "\xC3\xA9", "0x1F", "no",   "a-b", "2001-12-14"};
+            static const char *const kBlockOnly[] = {"a:b", "x, y", "[not", "{not", "ends:"};
+            static const char *const kQuoted[] = {"\"q \\\" \\n\"", "'it''s'", "\"\\u00e9\\t\"", "\"\"", "''",
+                                                  "\"a: b\"", "'# no'", "\"multi\n  line\""};
+
+            switch (below(8))
+            {
+            case 0:
+            case 1:
+                return pick(kQuoted);
+            case 2:
+                if (!flow)
+                    return pick(kBlockOnly);
+                [[fallthrough]];
+            default:
+                return pick(kPlain);
+            }
+        }
+
+        std::string key(bool flow)
+        {
+            static const char *const kKeys[] = {"k1", "k2", "k3", "key", "name", "x", "\"quoted key\"", "'single'",
+                                                "12", "true"};
+            (void)flow;
+            return pick(kKeys);
+        }
+
+        // " &aN" before a node, or nothing
+        std::string anchor()
+        {
+            if (below(6) != 0)
+                return {};
+
+            return "&a" + std::to_string(++mAnchors) + " ";
+        }
+
+        // "*aN" for an anchor defined earlier, or a scalar
+        std::string alias_or_scalar(bool flow)
+        {
+            if (mAnchors != 0 && below(8) == 0)
+                return "*a" + std::to_string(1 + below(mAnchors));
+
+            return anchor() + scalar(flow);
+        }
+
+        void indent(std::string &out, size_t level) { out.append(level, ' '); }
+
+        void block_collection(std::string &out, size_t level, size_t depth, bool map)
+        {
+            for (size_t i = 0, count = 1 + below(4); i != count; i++)
+            {
+                indent(out, level);
+                out += map ? key(false) + ":" : std::string{"-"};
+
+                switch (depth < 3 ? below(6) : 0)
+                {
+                case 0:
+                case 1:
+                    out += " " + alias_or_scalar(false) + "\n";
+                    break;
+                case 2:
+                    out += " ";
+                    flow_node(out, depth + 1, false);
+                    out += "\n";
+                    break;
+                case 3:
+                    out += below(2) ? " |\n" : " >-\n";
+                    for (size_t line = 0, lines = 1 + below(3); line != lines; line++)
+                    {
+                        indent(out, level + 2);
+                        out += "text " + std::to_string(line) + "\n";
+                    }
+                    break;
+                default: {
+                    std::string a = anchor();
+                    if (!a.empty())
+                        out += " " + a.substr(0, a.size() - 1);
+                    if (below(5) == 0)
+                        out += " # note";
+                    out += "\n";
+                    block_collection(out, level + 2, depth + 1, below(2) != 0);
+                    break;
+                }
+                }
+            }
+        }
+
+        void flow_node(std::string &out, size_t depth, bool json)
+        {
+            static const char *const kJsonScalars[] = {"1", "-0.5", "2e10", "true", "false", "null", "\"s\"",
+                                                       "\"\\u00e9\\n\\\"\"", "\"a: b\"", "\"\"", "\"\\ud83d\\ude00\""};
+            static const char *const kJsonKeys[] = {"\"a\"", "\"b\"", "\"key\"", "\"\"", "\"\\u0041\"", "\"x y\""};
+
+            size_t kind = depth < 3 ? below(4) : 0;
+            if (kind < 2 && depth != 0)
+            {
+                out += json ? pick(kJsonScalars) : alias_or_scalar(true);
+                return;
+            }
+
+            bool map = kind != 3;
+            if (!json)
+                out += anchor();
+
+            out += map ? '{' : '[';
+            for (size_t i = 0, count = below(4); i != count; i++)
+            {
+                if (i != 0)
+                    out += below(3) ? ", " : ",";
+
+                if (map)
+                    out += (json ? std::string{pick(kJsonKeys)} : key(true)) + ": ";
+
+                flow_node(out, depth + 1, json);
+            }
+            out += map ? '}' : ']';
+        }
+
+        std::mt19937_64 mRng;
+        size_t mAnchors = 0;
+    };
+} // namespace yaml_fuzz
@@ -0,0 +1,42 @@
+#include "differential.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+
+// libFuzzer entry: built with -fsanitize=fuzzer and ULIB_YAML_LIBFUZZER every input goes through all parse paths.
+// without it the inputs are read from the files given on the command line, e.g. to replay a crash
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    std::string text{(const char *)data, size};
+    std::string diff = yaml_fuzz::check(text, nullptr, size);
+    if (!diff.empty())
+    {
+        std::fprintf(stderr, "%s\n--- input:\n%s\n---\n", diff.c_str(), text.c_str());
+        std::abort();
+    }
+
+    return 0;
+}
+
+#ifndef ULIB_YAML_LIBFUZZER
+int main(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::ifstream file{argv[i], std::ios::binary};
+        if (!file)
+        {
+            std::fprintf(stderr, "can't open %s\n", argv[i]);
+            return 1;
+        }
+
+        std::string text{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+        LLVMFuzzerTestOneInput((const uint8_t *)text.data(), text.size());
+        std::printf("%s: ok\n", argv[i]);
+    }
+
+    return 0;
+}
+#endif
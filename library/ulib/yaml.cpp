@@ -1,9 +1,75 @@
 #include "yaml.h"
+#include "yaml_detail.h"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
 
 namespace ulib
 {
+    yaml::key_string::key_string(StringViewT str) : mData(nullptr)
+    {
+        if (str.size() == 0)
+            return;
+
+        void *mem = ::operator new(sizeof(data) + str.size() * sizeof(CharT));
+        mData = new (mem) data;
+        mData->refs.store(1, std::memory_order_relaxed);
+        mData->hash = hash_of(str);
+        mData->size = str.size();
+        std::memcpy(mData->chars(), str.data(), str.size() * sizeof(CharT));
+    }
+
+    void yaml::key_string::release()
+    {
+        if (mData && mData->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            mData->~data();
+            ::operator delete(mData);
+        }
+
+        mData = nullptr;
+    }
+
+    uint64_t yaml::key_string::hash_of(StringViewT str)
+    {
+        return yaml_detail::fnv1a(str.data(), str.size() * sizeof(CharT));
+    }
+
+    uint64_t yaml::key_string::empty_hash() { return yaml_detail::kFnvOffsetBasis; }
+
+    yaml::key_string yaml::key_pool::intern(StringViewT str)
+    {
+        std::lock_guard<std::mutex> lock{mMutex};
+
+        auto it = mKeys.find(std::basic_string_view<CharT>{str.data(), str.size()});
+        if (it != mKeys.end())
+            return it->second;
+
+        key_string key{str};
+        StringViewT stored = key.str();
+        return mKeys.emplace(std::basic_string_view<CharT>{stored.data(), stored.size()}, std::move(key))
+            .first->second;
+    }
+
+    size_t yaml::key_pool::size() const
+    {
+        std::lock_guard<std::mutex> lock{mMutex};
+        return mKeys.size();
+    }
+
+    void yaml::key_pool::clear()
+    {
+        std::lock_guard<std::mutex> lock{mMutex};
+        mKeys.clear();
+    }
+
     yaml::yaml(const yaml &v) { copy_construct_from_other(v); }
-    yaml::yaml(yaml &&v) { move_construct_from_other(std::move(v)); }
+    yaml::yaml(yaml &&v) noexcept { move_construct_from_other(std::move(v)); }
     yaml::yaml(value_t t)
     {
         switch (t)
@@ -23,6 +89,8 @@ namespace ulib
         }
     }
 
+    yaml::yaml(table &&columns) { construct_indirect(new table_node{std::move(columns)}); }
+
     yaml::~yaml() { destroy_containers(); }
 
     yaml &yaml::operator=(const yaml &right)
@@ -45,17 +113,196 @@ namespace ulib
         return mSequence.emplace_back();
     }
 
+    void yaml::push_back(yaml &&yml)
+    {
+        implicit_touch_array();
+        mSequence.push_back(std::move(yml));
+    }
+
+    void yaml::reserve(size_t count)
+    {
+        detach();
+
+        if (mType == value_t::map)
+            mMap.reserve(count);
+        else if (mType == value_t::sequence)
+            mSequence.reserve(count);
+        else
+            throw yaml::value_error(
+                ulib::string{"[yaml.value_error] ulib::yaml.reserve(): node must be a map or a sequence, but is "} +
+                type_to_string(mType));
+    }
+
+    yaml &yaml::emplace(const KeyT &key, yaml &&value)
+    {
+        implicit_touch_object();
+        mMap.emplace_back(key, std::move(value));
+
+        if (!mSorted)
+            return mMap.back().value();
+
+        // after the items with the same key, like an append to an unsorted map
+        size_t pos = lower_bound(key.str());
+        while (pos != mMap.size() - 1 && yaml_detail::compare_bytes(mMap[pos].name(), key.str()) == 0)
+            pos++;
+
+        ItemT *first = mMap.data();
+        std::rotate(first + pos, first + mMap.size() - 1, first + mMap.size());
+        return mMap[pos].value();
+    }
+
+    namespace yaml_detail
+    {
+        // position of the first item with each name, the one find_item() would return
+        class item_index
+        {
+        public:
+            item_index(const yaml::MapT &map, size_t extra)
+            {
+                mPositions.reserve(map.size() + extra);
+                for (size_t i = 0; i != map.size(); i++)
+                    find_or_add(map[i].name(), i);
+            }
+
+            // index of the item named name, or adds position for it and returns npos
+            size_t find_or_add(yaml::StringViewT name, size_t position)
+            {
+                auto result = mPositions.emplace(std::string_view{name.data(), name.size()}, position);
+                return result.second ? size_t(-1) : result.first->second;
+            }
+
+        private:
+            // views into the key buffers, which stay put while the items move
+            std::unordered_map<std::string_view, size_t> mPositions;
+        };
+        inline bool key_less(const yaml::ItemT &left, const yaml::ItemT &right)
+        {
+            return compare_bytes(left.name(), right.name()) < 0;
+        }
+
+        // items from size on were appended to a sorted map with unique keys
+        void merge_sorted_tail(yaml::MapT &map, size_t size)
+        {
+            auto first = map.data();
+            auto middle = first + size;
+            auto last = first + map.size();
+
+            std::stable_sort(middle, last, key_less);
+            std::inplace_merge(first, middle, last, key_less);
+        }
+    } // namespace yaml_detail
+
+    void yaml::insert_range(span<const ItemT> items)
+    {
+        implicit_touch_object();
+
+        // items of this map would move with reserve()
+        if (items.data() >= mMap.data() && items.data() < mMap.data() + mMap.size())
+        {
+            MapT copy;
+            copy.reserve(items.size());
+            for (auto &itm : items)
+                copy.push_back(itm);
+
+            insert_range(std::move(copy));
+            return;
+        }
+
+        mMap.reserve(mMap.size() + items.size());
+        size_t size = mMap.size();
+
+        yaml_detail::item_index index{mMap, items.size()};
+        for (auto &itm : items)
+        {
+            size_t existing = index.find_or_add(itm.name(), mMap.size());
+            if (existing != size_t(-1))
+                mMap[existing].value() = itm.value();
+            else
+                mMap.emplace_back(itm);
+        }
+
+        if (mSorted)
+            yaml_detail::merge_sorted_tail(mMap, size);
+    }
+
+    void yaml::insert_range(MapT &&items)
+    {
+        implicit_touch_object();
+        mMap.reserve(mMap.size() + items.size());
+        size_t size = mMap.size();
+
+        yaml_detail::item_index index{mMap, items.size()};
+        for (auto &itm : items)
+        {
+            size_t existing = index.find_or_add(itm.name(), mMap.size());
+            if (existing != size_t(-1))
+                mMap[existing].value() = std::move(itm.value());
+            else
+                mMap.push_back(std::move(itm));
+        }
+
+        if (mSorted)
+            yaml_detail::merge_sorted_tail(mMap, size);
+    }
+
+    void yaml::insert_range(span<const yaml> values)
+    {
+        implicit_touch_array();
+
+        if (values.data() >= mSequence.data() && values.data() < mSequence.data() + mSequence.size())
+        {
+            SequenceT copy;
+            copy.reserve(values.size());
+            for (auto &val : values)
+                copy.push_back(val);
+
+            insert_range(std::move(copy));
+            return;
+        }
+
+        mSequence.reserve(mSequence.size() + values.size());
+
+        for (auto &val : values)
+            mSequence.push_back(val);
+    }
+
+    void yaml::insert_range(SequenceT &&values)
+    {
+        implicit_touch_array();
+        mSequence.reserve(mSequence.size() + values.size());
+
+        for (auto &val : values)
+            mSequence.push_back(std::move(val));
+    }
+
     // if value is exists, works like "at" otherwise creates value and set value type to null
     yaml &yaml::find_or_create(StringViewT name)
+    {
+        return find_or_create(KeyT{name});
+    }
+
+    yaml &yaml::find_or_create(const KeyT &name)
     {
         if (implicit_touch_object())
             return mMap.emplace_back(name).value();
 
-        for (auto &obj : mMap)
-            if (obj.name() == name)
-                return obj.value();
+        if (!mSorted)
+        {
+            if (ItemT *item = find_item(name.str(), name.hash()))
+                return item->value();
+
+            return mMap.emplace_back(name).value();
+        }
+
+        size_t pos = lower_bound(name.str());
+        if (pos != mMap.size() && mMap[pos].key().equals(name.str(), name.hash()))
+            return mMap[pos].value();
 
-        return mMap.emplace_back(name).value();
+        // appended, then rotated into place
+        mMap.emplace_back(name);
+        ItemT *first = mMap.data();
+        std::rotate(first + pos, first + mMap.size() - 1, first + mMap.size());
+        return mMap[pos].value();
     }
 
     yaml &yaml::find_or_create(size_t idx)
@@ -74,15 +321,17 @@ namespace ulib
 
     const yaml &yaml::find_if_exists(StringViewT name) const
     {
+        if (mIndirect)
+            return resolve_indirect().find_if_exists(name);
+
         if (mType != value_t::map)
             throw key_error{ulib::string{"[yaml.key_error] ulib::yaml.find_if_exists(\""} + name + "\")" +
                             ": node must be a map"};
 
         implicit_const_touch_object();
 
-        for (auto &obj : mMap)
-            if (obj.name() == name)
-                return obj.value();
+        if (const ItemT *item = find_item(name, KeyT::hash_of(name)))
+            return item->value();
 
         throw key_error{ulib::string{"[yaml.key_error] ulib::yaml.find_if_exists(\""} + name + "\")" +
                         ": key not found"};
@@ -90,6 +339,9 @@ namespace ulib
 
     const yaml &yaml::find_if_exists(size_t idx) const
     {
+        if (mIndirect)
+            return resolve_indirect().find_if_exists(idx);
+
         if (mType != value_t::sequence)
             throw key_error{ulib::string{"[yaml.key_error] ulib::yaml.find_if_exists("} + std::to_string(idx) + ")" +
                             ": node must be a sequence"};
@@ -101,8 +353,53 @@ namespace ulib
         return mSequence[idx];
     }
 
+    const void *yaml::alias_id() const { return mIndirect && !mNode->inlined() ? mNode : nullptr; }
+
+    yaml::StringViewT yaml::anchor_name() const { return mIndirect ? mNode->anchor() : StringViewT{}; }
+
+    const yaml::table *yaml::as_table() const { return mIndirect ? mNode->as_table() : nullptr; }
+
     // private: -----------------------
 
+    const yaml &yaml::resolve_indirect() const { return mNode->get().resolved(); }
+
+    // a columnar table answers without building its rows
+    yaml::value_t yaml::indirect_type() const
+    {
+        return mNode->as_table() ? value_t::sequence : resolve_indirect().mType;
+    }
+
+    size_t yaml::indirect_size() const
+    {
+        if (auto columns = mNode->as_table())
+            return columns->rows();
+
+        return values().size();
+    }
+
+    void yaml::detach_indirect()
+    {
+        shared_node *node = mNode;
+
+        // sole owner: the value can be moved out, otherwise every other reference keeps seeing the original
+        yaml value = node->unique() ? yaml{node->take()} : yaml{node->get()};
+
+        node->release();
+        mIndirect = false;
+        mType = value_t::null;
+        move_construct_from_other(std::move(value));
+
+        // the value can be an indirect node itself
+        detach();
+    }
+
+    void yaml::construct_indirect(shared_node *node)
+    {
+        mNode = node;
+        mIndirect = true;
+        mType = value_t::null;
+    }
+
     void yaml::initialize_as_string()
     {
         new (&mScalar) StringT;
@@ -113,6 +410,7 @@ namespace ulib
     {
         new (&mMap) MapT;
         mType = value_t::map;
+        mSorted = false;
     }
 
     void yaml::initialize_as_array()
@@ -123,6 +421,8 @@ namespace ulib
 
     bool yaml::implicit_touch_string()
     {
+        detach();
+
         if (mType == value_t::scalar)
             return false;
 
@@ -136,6 +436,8 @@ namespace ulib
 
     bool yaml::implicit_touch_object()
     {
+        detach();
+
         if (mType == value_t::map)
             return false;
 
@@ -149,6 +451,8 @@ namespace ulib
 
     bool yaml::implicit_touch_array()
     {
+        detach();
+
         if (mType == value_t::sequence)
             return false;
 
@@ -162,27 +466,32 @@ namespace ulib
 
     void yaml::implicit_const_touch_string() const
     {
-        if (mType != value_t::scalar)
+        value_t t = type();
+        if (t != value_t::scalar)
             throw yaml::exception(ulib::string{"yaml value must be a string while implicit const touch. current: "} +
-                                  type_to_string(mType));
+                                  type_to_string(t));
     }
 
     void yaml::implicit_const_touch_object() const
     {
-        if (mType != value_t::map)
+        value_t t = type();
+        if (t != value_t::map)
             throw yaml::exception(ulib::string{"yaml value must be a map while implicit const touch. current: "} +
-                                  type_to_string(mType));
+                                  type_to_string(t));
     }
 
     void yaml::implicit_const_touch_array() const
     {
-        if (mType != value_t::sequence)
+        value_t t = type();
+        if (t != value_t::sequence)
             throw yaml::exception(ulib::string{"yaml value must be a sequence while implicit const touch. current: "} +
-                                  type_to_string(mType));
+                                  type_to_string(t));
     }
 
     void yaml::implicit_set_string(StringViewT other)
     {
+        detach();
+
         if (mType == value_t::scalar)
         {
             mScalar.assign(other);
@@ -200,6 +509,8 @@ namespace ulib
 
     void yaml::implicit_move_set_string(StringT &&other)
     {
+        detach();
+
         if (mType == value_t::scalar)
         {
             mScalar.assign(std::move(other));
@@ -217,6 +528,8 @@ namespace ulib
 
     void yaml::implicit_set_float(double other)
     {
+        detach();
+
         if (mType == value_t::scalar)
         {
             mScalar = std::to_string(other);
@@ -234,6 +547,8 @@ namespace ulib
 
     void yaml::implicit_set_integer(int64_t other)
     {
+        detach();
+
         if (mType == value_t::scalar)
         {
             mScalar = std::to_string(other);
@@ -251,6 +566,8 @@ namespace ulib
 
     void yaml::implicit_set_boolean(bool other)
     {
+        detach();
+
         if (mType == value_t::scalar)
         {
             mScalar = other ? "true" : "false";
@@ -280,13 +597,67 @@ namespace ulib
 
     void yaml::copy_construct_from_other(const yaml &other)
     {
+        // nested containers are copied from a list of pending levels, so a deep document doesn't recurse
+        copy_shallow(other);
+
+        ulib::List<std::pair<yaml *, const yaml *>> pending;
+        yaml *dest = this;
+        const yaml *src = &other;
+        while (true)
+        {
+            if (!src->mIndirect && src->mType == value_t::map)
+            {
+                for (auto &item : src->mMap)
+                {
+                    yaml &value = dest->mMap.emplace_back(item.key()).value();
+                    value.copy_shallow(item.value());
+                    if (!value.mIndirect && (value.mType == value_t::map || value.mType == value_t::sequence))
+                        pending.emplace_back(&value, &item.value());
+                }
+            }
+            else if (!src->mIndirect && src->mType == value_t::sequence)
+            {
+                for (auto &item : src->mSequence)
+                {
+                    yaml &value = dest->mSequence.emplace_back();
+                    value.copy_shallow(item);
+                    if (!value.mIndirect && (value.mType == value_t::map || value.mType == value_t::sequence))
+                        pending.emplace_back(&value, &item);
+                }
+            }
+
+            if (pending.empty())
+                return;
+
+            dest = pending.back().first;
+            src = pending.back().second;
+            pending.pop_back();
+        }
+    }
+
+    void yaml::copy_shallow(const yaml &other)
+    {
+        mStyle = other.mStyle;
+        mSorted = other.mSorted;
+        if (other.mIndirect)
+        {
+            // copies of an indirect node share its target
+            other.mNode->retain();
+            construct_indirect(other.mNode);
+            return;
+        }
+
+        // containers get their capacity, the items are added by copy_construct_from_other()
+        mIndirect = false;
         switch (other.mType)
         {
         case value_t::map:
-            new (&mMap) MapT(other.mMap);
+            new (&mMap) MapT();
+            mMap.reserve(other.mMap.size());
             break;
         case value_t::sequence:
-            new (&mSequence) SequenceT(other.mSequence);
+            new (&mSequence) SequenceT();
+            mSequence.reserve(other.mSequence.size());
             break;
         case value_t::scalar:
             new (&mScalar) StringT(other.mScalar);
@@ -300,6 +671,17 @@ namespace ulib
 
     void yaml::move_construct_from_other(yaml &&other)
     {
+        mStyle = other.mStyle;
+        mSorted = other.mSorted;
+        if (other.mIndirect)
+        {
+            construct_indirect(other.mNode);
+            other.mIndirect = false;
+            other.mType = value_t::null;
+            return;
+        }
+
+        mIndirect = false;
         switch (other.mType)
         {
         case value_t::map:
@@ -321,12 +703,24 @@ namespace ulib
 
     void yaml::destroy_containers()
     {
+        if (mIndirect)
+        {
+            mNode->release();
+            mIndirect = false;
+            mType = value_t::null;
+            return;
+        }
+
         switch (mType)
         {
         case value_t::map:
+            if (!mMap.empty())
+                destroy_nested();
             mMap.~MapT();
             break;
         case value_t::sequence:
+            if (!mSequence.empty())
+                destroy_nested();
             mSequence.~SequenceT();
             break;
         case value_t::scalar:
@@ -338,22 +732,211 @@ namespace ulib
         }
     }
 
-    yaml *yaml::find_object_in_object(StringViewT name)
+    void yaml::destroy_nested()
     {
-        for (auto &obj : mMap)
-            if (obj.name() == name)
-                return &obj;
+        // nested containers are moved out and destroyed one by one from a list, each with only leaves left in
+        // it, so a deep document isn't destroyed by a recursion per level
+        ulib::List<yaml> pending;
+        auto take = [&](yaml &child) {
+            if (child.mIndirect)
+            {
+                // the last reference to a shared value gives it up as well
+                if (child.mNode->unique() && child.mNode->ready())
+                    pending.push_back(std::move(child.mNode->value()));
+                return;
+            }
+
+            if ((child.mType == value_t::map && !child.mMap.empty()) ||
+                (child.mType == value_t::sequence && !child.mSequence.empty()))
+                pending.push_back(std::move(child));
+        };
+
+        auto take_children = [&](yaml &node) {
+            if (node.mType == value_t::map)
+                for (auto &item : node.mMap)
+                    take(item.value());
+            else if (node.mType == value_t::sequence)
+                for (auto &value : node.mSequence)
+                    take(value);
+        };
+
+        take_children(*this);
+        while (!pending.empty())
+        {
+            yaml node = std::move(pending.back());
+            pending.pop_back();
+            take_children(node);
+        }
+    }
 
-        return nullptr;
+    yaml::ItemT *yaml::find_item(StringViewT name, uint64_t hash)
+    {
+        return const_cast<ItemT *>(static_cast<const yaml *>(this)->find_item(name, hash));
     }
 
-    const yaml *yaml::find_object_in_object(StringViewT name) const
+    const yaml::ItemT *yaml::find_item(StringViewT name, uint64_t hash) const
     {
+        if (mSorted)
+        {
+            size_t pos = lower_bound(name);
+            if (pos != mMap.size() && mMap[pos].key().equals(name, hash))
+                return &mMap[pos];
+
+            return nullptr;
+        }
+
         for (auto &obj : mMap)
-            if (obj.name() == name)
+            if (obj.key().equals(name, hash))
                 return &obj;
 
         return nullptr;
     }
 
+    size_t yaml::lower_bound(StringViewT name) const
+    {
+        // branchless: the loop only narrows base, the comparison result selects the step
+        const ItemT *base = mMap.data();
+        size_t size = mMap.size();
+        if (size == 0)
+            return 0;
+
+        while (size > 1)
+        {
+            size_t half = size / 2;
+            base += (yaml_detail::compare_bytes(base[half - 1].name(), name) < 0) * half;
+            size -= half;
+        }
+
+        return size_t(base - mMap.data()) + (yaml_detail::compare_bytes(base->name(), name) < 0);
+    }
+
+    void yaml::sort_items()
+    {
+        ItemT *first = mMap.data();
+        std::stable_sort(first, first + mMap.size(), yaml_detail::key_less);
+        mSorted = true;
+    }
+
+    void yaml::sort_trees(yaml *const *nodes, size_t count)
+    {
+        // maps are sorted after their children. every shared node is replaced by a sorted copy, made on its
+        // first reference under any of the nodes
+        struct sorter : transformer
+        {
+            ~sorter()
+            {
+                for (auto &entry : copies)
+                {
+                    entry.first->release();
+                    entry.second->release();
+                }
+            }
+
+            bool enter(yaml &node, const visit_info &) override
+            {
+                if (!node.mIndirect)
+                    return true;
+
+                shared_node *original = node.mNode;
+                auto it = copies.find(original);
+                if (it == copies.end())
+                {
+                    shared_node *copy;
+                    if (auto columns = original->as_table())
+                    {
+                        table sorted = *columns;
+                        sorted.sort_keys();
+                        copy = new table_node{std::move(sorted)};
+                    }
+                    else
+                    {
+                        yaml value = original->unique() ? yaml{original->take()} : yaml{original->get()};
+                        value.traverse(*this);
+                        copy = new shared_node{std::move(value)};
+                    }
+
+                    // the original stays alive so that its address isn't reused for another node
+                    copy->set_anchor(original->anchor());
+                    if (original->inlined())
+                        copy->set_inlined();
+                    original->retain();
+                    it = copies.emplace(original, copy).first;
+                }
+
+                it->second->retain();
+                node.mNode = it->second;
+                original->release();
+                return false;
+            }
+
+            void leave(yaml &node, const visit_info &) override
+            {
+                if (node.mType == value_t::map)
+                    node.sort_items();
+            }
+
+            std::unordered_map<shared_node *, shared_node *> copies;
+        };
+
+        sorter pass;
+        for (size_t i = 0; i != count; i++)
+            nodes[i]->traverse(pass);
+    }
+
+    void yaml::sort_keys(size_t threads)
+    {
+        // a shared root is replaced as a whole
+        if (mIndirect)
+        {
+            yaml *self = this;
+            sort_trees(&self, 1);
+            return;
+        }
+
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+
+        ulib::List<yaml *> children;
+        if (mType == value_t::map)
+            for (auto &itm : mMap)
+                children.push_back(&itm.value());
+        else if (mType == value_t::sequence)
+            for (auto &val : mSequence)
+                children.push_back(&val);
+
+        // the subtrees are disjoint, each thread takes a contiguous share of them
+        size_t count = std::min(threads, children.size());
+        if (count > 1)
+        {
+            ulib::List<std::thread> workers;
+            for (size_t i = 1; i != count; i++)
+                workers.emplace_back([&children, i, count]() {
+                    size_t begin = children.size() * i / count, end = children.size() * (i + 1) / count;
+                    sort_trees(children.data() + begin, end - begin);
+                });
+
+            sort_trees(children.data(), children.size() / count);
+
+            for (auto &worker : workers)
+                worker.join();
+        }
+        else
+        {
+            sort_trees(children.data(), children.size());
+        }
+
+        if (mType == value_t::map)
+            sort_items();
+    }
+
+    yaml *yaml::find_object_in_object(StringViewT name)
+    {
+        return find_item(name, KeyT::hash_of(name));
+    }
+
+    const yaml *yaml::find_object_in_object(StringViewT name) const
+    {
+        return find_item(name, KeyT::hash_of(name));
+    }
+
 } // namespace ulib
@@ -4,7 +4,14 @@
 #include <ulib/string.h>
 #include <ulib/runtimeerror.h>
 
+#include <atomic>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
 
 namespace ulib
 {
@@ -46,22 +53,52 @@ namespace ulib
             using ThisT = basic_item<JsonT>;
             using StringT = typename JsonT::StringT;
             using StringViewT = typename JsonT::StringViewT;
+            using KeyT = typename JsonT::KeyT;
 
             basic_item() : JsonT(), mName() {}
             basic_item(const basic_item &other) : JsonT(other), mName(other.mName) {}
+            // noexcept like the node's, growing maps move their items
+            basic_item(basic_item &&other) noexcept : JsonT(std::move(other)), mName(std::move(other.mName))
+            {
+                this->mItemId = other.mItemId;
+                other.mItemId = 0;
+            }
             basic_item(StringViewT name) : JsonT(), mName(name) {}
+            basic_item(const KeyT &name) : JsonT(), mName(name) {}
+            basic_item(const KeyT &name, JsonT &&value) : JsonT(std::move(value)), mName(name) {}
             ~basic_item() {}
 
+            // a copy is another item, a moved item keeps its identity
+            basic_item &operator=(const basic_item &other)
+            {
+                JsonT::operator=(other);
+                mName = other.mName;
+                this->mItemId = 0;
+                return *this;
+            }
+
+            basic_item &operator=(basic_item &&other)
+            {
+                JsonT::operator=(std::move(other));
+                mName = std::move(other.mName);
+                this->mItemId = other.mItemId;
+                other.mItemId = 0;
+                return *this;
+            }
+
             // ulib::string_view name() { return this->name(); }
-            StringViewT name() const { return mName; }
+            StringViewT name() const { return mName.str(); }
+            const KeyT &key() const { return mName; }
             JsonT &value() { return *this; }
             const JsonT &value() const { return *this; }
 
         private:
-            StringT mName;
+            friend JsonT;
+
+            KeyT mName;
         };
 
-        enum class value_t
+        enum class value_t : uint8_t
         {
             null,
             scalar,
@@ -69,6 +106,15 @@ namespace ulib
             map,
         };
 
+        // presentation recorded by parse_options::preserve_style, any lets dump() choose
+        enum class style_t : uint8_t
+        {
+            any,
+            block,  // collection written as indented lines
+            flow,   // collection written inline as {a: 1} or [1, 2]
+            quoted, // scalar written in quotes even if plain would read back the same
+        };
+
         using ThisT = ulib::yaml;
         using EncodingT = ulib::MultibyteEncoding;
         using CharT = typename EncodingT::CharT;
@@ -76,9 +122,113 @@ namespace ulib
         using StringT = ulib::EncodedString<EncodingT, AllocatorT>;
         using StringViewT = ulib::EncodedStringView<EncodingT>;
 
+        // immutable ref-counted map key with a precomputed hash. copies share one buffer,
+        // and keys created by the same key_pool share one buffer per distinct string
+        class key_string
+        {
+        public:
+            key_string() : mData(nullptr) {}
+            key_string(StringViewT str);
+            key_string(const key_string &other) : mData(other.mData) { retain(); }
+            key_string(key_string &&other) : mData(other.mData) { other.mData = nullptr; }
+            ~key_string() { release(); }
+
+            key_string &operator=(const key_string &other)
+            {
+                if (mData != other.mData)
+                {
+                    other.retain();
+                    release();
+                    mData = other.mData;
+                }
+
+                return *this;
+            }
+
+            key_string &operator=(key_string &&other)
+            {
+                if (this != &other)
+                {
+                    release();
+                    mData = other.mData;
+                    other.mData = nullptr;
+                }
+
+                return *this;
+            }
+
+            StringViewT str() const { return mData ? StringViewT{mData->chars(), mData->size} : StringViewT{}; }
+            uint64_t hash() const { return mData ? mData->hash : empty_hash(); }
+
+            // true if both keys share one buffer, e.g. both were interned by the same pool
+            bool same(const key_string &other) const { return mData == other.mData; }
+
+            // hash must be hash_of(str)
+            bool equals(StringViewT str, uint64_t hash) const
+            {
+                if (!mData)
+                    return str.size() == 0;
+
+                return mData->hash == hash && mData->size == str.size() &&
+                       std::char_traits<CharT>::compare(mData->chars(), str.data(), str.size()) == 0;
+            }
+
+            static uint64_t hash_of(StringViewT str);
+
+            // the shared buffer and its size in bytes, null and 0 for an empty key
+            const void *buffer() const { return mData; }
+            size_t allocated() const { return mData ? sizeof(data) + mData->size * sizeof(CharT) : 0; }
+
+        private:
+            struct data
+            {
+                std::atomic<size_t> refs;
+                uint64_t hash;
+                size_t size;
+
+                CharT *chars() { return (CharT *)(this + 1); }
+            };
+
+            static uint64_t empty_hash();
+
+            void retain() const
+            {
+                if (mData)
+                    mData->refs.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            void release();
+
+            data *mData;
+        };
+
+        // interns map keys: each distinct string is stored once and every key created by the pool shares it.
+        // can be kept per document (the default for parse()) or shared between documents and threads
+        class key_pool
+        {
+        public:
+            key_pool() {}
+            key_pool(const key_pool &) = delete;
+            key_pool &operator=(const key_pool &) = delete;
+
+            key_string intern(StringViewT str);
+            size_t size() const;
+            void clear();
+
+        private:
+            mutable std::mutex mMutex;
+            std::unordered_map<std::basic_string_view<CharT>, key_string> mKeys;
+        };
+
+        using KeyT = key_string;
         using ItemT = basic_item<ulib::yaml>;
         using MapT = ulib::List<ItemT, AllocatorT>;
         using SequenceT = ulib::List<ThisT, AllocatorT>;
+        using BinaryT = ulib::List<uint8_t, AllocatorT>;
+
+        // nesting levels dump(), dump_binary() and load_binary() handle, they recurse per level. copies,
+        // comparisons, destruction and traverse() don't and take any depth
+        static constexpr size_t max_depth = 2000;
 
         using Iterator = ulib::RandomAccessIterator<ThisT>;
         using ConstIterator = ulib::RandomAccessIterator<const ThisT>;
@@ -110,14 +260,132 @@ namespace ulib
         static yaml map() { return yaml{value_t::map}; }
         static yaml sequence() { return yaml{value_t::sequence}; }
 
+        class table;
+        class stream_parser;
+        class include_resolver;
+        class handle_pool;
+        class query;
+        class visitor;
+        class transformer;
+
+        // node kept by a handle_pool, see there. a default handle refers to nothing
+        struct node_handle
+        {
+            uint32_t index = 0;
+            uint32_t generation = 0;
+
+            // unique among the handles of a pool, also after release, for keys of external indexes
+            uint64_t id() const { return uint64_t(generation) << 32 | index; }
+
+            explicit operator bool() const { return generation != 0; }
+            bool operator==(const node_handle &other) const
+            {
+                return index == other.index && generation == other.generation;
+            }
+            bool operator!=(const node_handle &other) const { return !(*this == other); }
+        };
+
+        struct parse_options
+        {
+            // shared key pool, a pool per document is used if null
+            key_pool *keys = nullptr;
+
+            // store sequences of at least columnar_min_rows flat records with identical keys column-wise,
+            // see table and as_table()
+            bool columnar = false;
+            size_t columnar_min_rows = 16;
+
+            // aliases are stored as references to the anchored subtree, but a consumer that walks the tree still
+            // visits the subtree once per alias. parsing fails if that would add more than this many nodes,
+            // 0 disables the check
+            size_t max_alias_expansion = size_t(1) << 28;
+
+            // record flow/block collections and quoted scalars, so dump() writes them back the same way.
+            // comments and the choice of quote character are not reported by the parser and are lost
+            bool preserve_style = false;
+
+            // scan the top-level entries of a block map or sequence and parse each value on its first access.
+            // parse errors inside a value surface at that access. documents with anchors or a flow/JSON root
+            // are parsed eagerly. keys must outlive the document. the values that aren't parsed yet read from a
+            // copy of the whole input, parse_file() included, so the source may change or go away meanwhile
+            bool lazy = false;
+
+            // sort every map by key as it is built, see sort_keys()
+            bool sorted_maps = false;
+
+            // resolve "!include path" scalars to the document in that file, parsed with these options. relative
+            // paths start at the directory of the including file. documents with includes are parsed eagerly.
+            // null leaves the tag alone
+            include_resolver *includes = nullptr;
+
+            // replace ${NAME} and ${NAME:-default} in scalar values and include paths with environment variables,
+            // $${ stays a literal ${. an unset variable without a default fails the parse
+            bool expand_env = false;
+
+            // reject input that isn't UTF-8: overlong forms, surrogates, code points past U+10FFFF and cut off
+            // sequences. UTF-16 and UTF-32 input is transcoded before the check
+            bool validate_utf8 = false;
+        };
+
+        enum class format_t
+        {
+            block, // indented lines, the default
+            flow,  // one line, {a: 1, b: [1, 2]}
+            json,  // minified JSON, scalars that read as JSON numbers or booleans are written bare
+        };
+
+        struct dump_options
+        {
+            format_t format = format_t::block;
+
+            // spaces per nesting level in block output, at least 1
+            size_t indent = 1;
+
+            // in block output, collections of at most this many nodes are written in flow style, 0 disables
+            size_t flow_threshold = 0;
+
+            // block and JSON documents of at least parallel_min_nodes nodes are written by this many threads,
+            // each taking a range of top-level entries. 0 uses every core. the output doesn't depend on it
+            size_t threads = 1;
+            size_t parallel_min_nodes = size_t(1) << 16;
+
+            // map items in key order, aliases expanded and recorded styles ignored, so documents that compare
+            // equal produce the same bytes
+            bool canonical = false;
+        };
+
         static yaml parse(StringViewT str);
+        static yaml parse(StringViewT str, key_pool &keys);
+        static yaml parse(StringViewT str, const parse_options &options);
+        static yaml parse_file(StringViewT path);
+        static yaml parse_file(StringViewT path, const parse_options &options);
+
+        // JSON only. parse() takes this path by itself for input starting with '{' or '[' and falls back
+        // to the YAML parser if it isn't valid JSON
+        static yaml parse_json(StringViewT str);
+        static yaml parse_json(StringViewT str, const parse_options &options);
+
+        // parse_file() backed by binary images in cache_dir, keyed by path, size, mtime and content hash.
+        // entries are replaced atomically, so the cache can be shared between processes
+        static yaml parse_file_cached(StringViewT path, StringViewT cache_dir);
+
+        // binary image produced by dump_binary(), validated by version and checksum. images nested deeper than
+        // max_depth are rejected
+        static yaml load_binary(const void *data, size_t size);
+        static yaml load_binary(const BinaryT &data) { return load_binary(data.data(), data.size()); }
+        static yaml load_binary_file(StringViewT path);
 
         yaml() : mType(value_t::null) {}
         yaml(const yaml &v);
-        yaml(yaml &&v);
+
+        // noexcept, so growing sequences move their nodes and the map items in them keep their handle_pool ids
+        yaml(yaml &&v) noexcept;
 
         yaml(value_t t);
 
+        // sequence of records backed by columns, materialized on first access through the node API
+        explicit yaml(table &&columns);
+
         template <class T, class TEncodingT = argument_encoding_or_die_t<T>>
         yaml(const T &v)
         {
@@ -189,8 +457,9 @@ namespace ulib
         template <class T, std::enable_if_t<std::is_floating_point_v<T>, bool> = true>
         std::optional<T> try_get() const
         {
-            if (mType == value_t::scalar)
-                return parse_float(mScalar);
+            auto &self = resolved();
+            if (self.mType == value_t::scalar)
+                return parse_float(self.mScalar);
 
             return std::nullopt;
         }
@@ -198,9 +467,10 @@ namespace ulib
         template <class T, std::enable_if_t<std::is_same_v<T, bool>, bool> = true>
         std::optional<T> try_get() const
         {
-            if (mType == value_t::scalar)
+            auto &self = resolved();
+            if (self.mType == value_t::scalar)
             {
-                auto &s = mScalar;
+                auto &s = self.mScalar;
 
                 if (s == "y" || s == "Y" || s == "yes" || s == "Yes" || s == "YES")
                     return true;
@@ -224,8 +494,9 @@ namespace ulib
         template <class T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>, bool> = true>
         std::optional<T> try_get() const
         {
-            if (mType == value_t::scalar)
-                return parse_integer(mScalar);
+            auto &self = resolved();
+            if (self.mType == value_t::scalar)
+                return parse_integer(self.mScalar);
 
             return std::nullopt;
         }
@@ -234,10 +505,11 @@ namespace ulib
                   std::enable_if_t<is_string_v<T>, bool> = true>
         std::optional<T> try_get() const
         {
-            if (mType == value_t::scalar)
-                return ulib::Convert<TEncodingT>(ulib::u8(mScalar));
+            auto &self = resolved();
+            if (self.mType == value_t::scalar)
+                return convert_scalar<T, TEncodingT>(self.mScalar);
 
-            if (mType == value_t::null)
+            if (self.mType == value_t::null)
                 return ulib::Convert<TEncodingT>(ulib::u8("null"));
 
             return std::nullopt;
@@ -248,10 +520,11 @@ namespace ulib
             std::enable_if_t<is_string_view_v<T> && is_encodings_raw_movable_v<EncodingT, TEncodingT>, bool> = true>
         std::optional<T> try_get() const
         {
-            if (mType == value_t::scalar)
-                return ulib::string_view{mScalar.raw_data(), mScalar.size()};
+            auto &self = resolved();
+            if (self.mType == value_t::scalar)
+                return ulib::string_view{self.mScalar.raw_data(), self.mScalar.size()};
 
-            if (mType == value_t::null)
+            if (self.mType == value_t::null)
                 return ulib::string_view{"null"};
 
             return std::nullopt;
@@ -267,7 +540,7 @@ namespace ulib
 
             throw yaml::value_error(ulib::string{"[yaml.value_error] ulib::yaml.get<T : floating_point>(): "
                                                  "invalid get() type: expected number, current: "} +
-                                    type_to_string(mType));
+                                    type_to_string(type()));
         }
 
         template <class T, std::enable_if_t<std::is_same_v<T, bool>, bool> = true>
@@ -278,7 +551,7 @@ namespace ulib
 
             throw yaml::value_error(ulib::string{"[yaml.value_error] ulib::yaml.get<T = bool>(): invalid get() "
                                                  "type: expected boolean, current: "} +
-                                    type_to_string(mType));
+                                    type_to_string(type()));
         }
 
         template <class T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>, bool> = true>
@@ -289,7 +562,7 @@ namespace ulib
 
             throw yaml::value_error(ulib::string{"[yaml.value_error] ulib::yaml.get<T : integral>(): invalid "
                                                  "get() type: expected number, current: "} +
-                                    type_to_string(mType));
+                                    type_to_string(type()));
         }
 
         template <class T, class VT = typename T::value_type, class TEncodingT = argument_encoding_or_die_t<T>,
@@ -301,7 +574,7 @@ namespace ulib
 
             throw yaml::value_error(ulib::string{"[yaml.value_error] ulib::yaml.get<T : string>(): invalid get() "
                                                  "type: expected string, current: "} +
-                                    type_to_string(mType));
+                                    type_to_string(type()));
         }
 
         template <
@@ -314,7 +587,7 @@ namespace ulib
 
             throw yaml::value_error(ulib::string{"[yaml.value_error] ulib::yaml.get<T : encoded_string>(): "
                                                  "invalid get() type: expected string, current: "} +
-                                    type_to_string(mType));
+                                    type_to_string(type()));
         }
 
         template <class T, std::enable_if_t<std::is_floating_point_v<T>, bool> = true>
@@ -347,13 +620,14 @@ namespace ulib
 
         // if value is exists, works like "at" otherwise creates value and set value type to null
         reference find_or_create(StringViewT name);
+        reference find_or_create(const KeyT &name);
         reference find_or_create(size_t idx);
 
         const_reference find_if_exists(StringViewT name) const;
         const_reference find_if_exists(size_t idx) const;
 
-        reference at(StringViewT key) { return reference(find_if_exists(key)); }
-        reference at(size_t idx) { return reference(find_if_exists(idx)); }
+        reference at(StringViewT key) { return detach(), reference(find_if_exists(key)); }
+        reference at(size_t idx) { return detach(), reference(find_if_exists(idx)); }
 
         const_reference at(StringViewT key) const { return find_if_exists(key); }
         const_reference at(size_t idx) const { return find_if_exists(idx); }
@@ -364,29 +638,31 @@ namespace ulib
         const_reference operator[](StringViewT key) const { return at(key); }
         const_reference operator[](size_t idx) const { return at(idx); }
 
-        span<const ItemT> items() const { return implicit_const_touch_object(), mMap; }
+        span<const ItemT> items() const { return implicit_const_touch_object(), resolved().mMap; }
         span<ItemT> items() { return implicit_touch_object(), mMap; }
 
-        span<const yaml> values() const { return implicit_const_touch_array(), mSequence; }
+        span<const yaml> values() const { return implicit_const_touch_array(), resolved().mSequence; }
         span<yaml> values() { return implicit_touch_array(), mSequence; }
 
-        iterator begin() { return implicit_const_touch_array(), mSequence.begin(); }
-        const_iterator begin() const { return implicit_const_touch_array(), mSequence.begin(); }
+        iterator begin() { return detach(), implicit_const_touch_array(), mSequence.begin(); }
+        const_iterator begin() const { return implicit_const_touch_array(), resolved().mSequence.begin(); }
 
-        iterator end() { return implicit_const_touch_array(), mSequence.end(); }
-        const_iterator end() const { return implicit_const_touch_array(), mSequence.end(); }
+        iterator end() { return detach(), implicit_const_touch_array(), mSequence.end(); }
+        const_iterator end() const { return implicit_const_touch_array(), resolved().mSequence.end(); }
 
         const yaml *search(StringViewT name) const
         {
-            if (mType != value_t::map)
+            auto &self = resolved();
+            if (self.mType != value_t::map)
                 throw yaml::value_error(ulib::string{"[yaml.value_error] ulib::yaml.search(\""} + name +
-                                        "\"): node must be a map, but is " + type_to_string(mType));
+                                        "\"): node must be a map, but is " + type_to_string(self.mType));
 
-            return find_object_in_object(name);
+            return self.find_object_in_object(name);
         }
 
         yaml *search(StringViewT name)
         {
+            detach();
             if (mType != value_t::map)
                 throw yaml::value_error(ulib::string{"[yaml.value_error] ulib::yaml.search(\""} + name +
                                         "\"): node must be a map, but is " + type_to_string(mType));
@@ -394,56 +670,197 @@ namespace ulib
             return find_object_in_object(name);
         }
 
-        size_t size() const { return values().size(); }
+        size_t size() const { return mIndirect ? indirect_size() : values().size(); }
         reference push_back();
-        value_t type() const { return mType; }
+        value_t type() const { return mIndirect ? indirect_type() : mType; }
 
         inline void push_back(const yaml &yml) { push_back() = yml; }
+        void push_back(yaml &&yml);
+
+        // sorts this map and every map below it by key bytes, keeping the order of equal keys. sorted maps find
+        // keys by binary search and insert new keys in order. the subtrees of the top-level entries are
+        // sorted on up to threads threads, 0 uses every core.
+        // a shared subtree is sorted once into a new shared node that its references in this tree point to,
+        // other documents keep the original. columnar tables reorder their columns, lazy values are parsed.
+        // a subtree shared between entries sorted on different threads is copied once per thread
+        void sort_keys(size_t threads = 1);
+        bool sorted() const { return resolved().mSorted; }
+
+        // capacity for count items or values, the node must be a map or a sequence
+        void reserve(size_t count);
+
+        // bytes held by a tree, see memory_usage()
+        struct memory_stats
+        {
+            size_t nodes = 0;    // node objects: this node, sequence values, map items and shared subtree holders
+            size_t keys = 0;     // key buffers, a buffer shared by many items counted once
+            size_t scalars = 0;  // scalar characters stored outside their node
+            size_t slack = 0;    // container and string capacity past the size
+            size_t retained = 0; // held by shared subtrees besides their value: table columns, unparsed lazy text
+            size_t node_count = 0;
+
+            size_t total() const { return nodes + keys + scalars + slack + retained; }
+        };
+
+        // walks the tree without building lazy values or columnar tables. their source text and columns count
+        // as retained, rows and values already built count like any other node. subtrees shared by aliases or
+        // copies count once
+        memory_stats memory_usage() const;
+
+        // reallocates every container and scalar to its size and makes equal keys share one buffer, for
+        // documents that are kept long after they are built. subtrees shared with nodes outside this tree are
+        // left alone, references into the tree are invalidated
+        void compact();
+        void compact(key_pool &keys);
+        void shrink_to_fit() { compact(); }
+
+        // where a traversal is: the map item holding the node, nullptr for sequence values and the root, the
+        // position in the parent and the distance from the root
+        struct visit_info
+        {
+            const ItemT *item = nullptr;
+            size_t index = 0;
+            size_t depth = 0;
+        };
+
+        // walks the tree once with an explicit stack, see visitor. several passes share the walk, each one in
+        // the order given, up to 64 of them
+        void traverse(visitor &pass) const;
+        void traverse(std::initializer_list<visitor *> passes) const;
+        void traverse(transformer &pass);
+        void traverse(std::initializer_list<transformer *> passes);
+
+        // appends an item without looking for one with the same name. the caller guarantees the key is new,
+        // otherwise lookups keep finding the older item
+        reference emplace(const KeyT &key, yaml &&value);
+        reference emplace(StringViewT key, yaml &&value) { return emplace(KeyT{key}, std::move(value)); }
+
+        // sets every item like operator[] does, with one key index for the whole batch
+        void insert_range(span<const ItemT> items);
+        void insert_range(const MapT &items) { insert_range(span<const ItemT>{items}); }
+        void insert_range(MapT &&items);
+
+        // appends the values to the sequence
+        void insert_range(span<const yaml> values);
+        void insert_range(SequenceT &&values);
 
         StringViewT scalar() const
         {
-            if (mType == value_t::scalar)
-                return mScalar;
+            auto &self = resolved();
+            if (self.mType == value_t::scalar)
+                return self.mScalar;
 
             throw yaml::value_error(
                 ulib::string{"[yaml.value_error] ulib::yaml.scalar(): node must be a scalar, but is "} +
-                type_to_string(mType));
+                type_to_string(self.mType));
+        }
+
+        // nodes matched by a path expression, see query. the expression is compiled on every call
+        ulib::List<const yaml *> select(StringViewT expression, size_t threads = 1) const;
+
+        // identity of the subtree this node shares with aliases of the same anchor and with its copies,
+        // nullptr if the node owns its value
+        const void *shared_id() const { return mIndirect ? mNode : nullptr; }
+
+        // shared_id() of a subtree dump() writes with an anchor and aliases, nullptr for one that is shared only
+        // to save memory and written out at every reference, like the document of an !include
+        const void *alias_id() const;
+
+        style_t style() const { return resolved().mStyle; }
+        void set_style(style_t style)
+        {
+            detach();
+            mStyle = style;
         }
 
+        // name of the anchor the shared subtree was parsed from, empty if there is none
+        StringViewT anchor_name() const;
+
+        // column store backing this sequence when it was loaded with parse_options::columnar, otherwise nullptr
+        const table *as_table() const;
+
+        // throws value_error for documents nested deeper than max_depth
         template <class TStringT = ulib::string, class TEncodingT = string_encoding_t<TStringT>,
                   std::enable_if_t<!std::is_same_v<TEncodingT, missing_type> && is_string_v<TStringT>, bool> = true>
         TStringT dump() const
         {
-            StringT result = yaml_serialize(*this);
+            StringT result = yaml_serialize(*this, dump_options{});
+            return ulib::Convert<TEncodingT>(ulib::u8(result));
+        }
+
+        template <class TStringT = ulib::string, class TEncodingT = string_encoding_t<TStringT>,
+                  std::enable_if_t<!std::is_same_v<TEncodingT, missing_type> && is_string_v<TStringT>, bool> = true>
+        TStringT dump(const dump_options &options) const
+        {
+            StringT result = yaml_serialize(*this, options);
             return ulib::Convert<TEncodingT>(ulib::u8(result));
         }
 
+        // dump() into a file, the parts of a parallel dump are written one after another without joining them
+        void dump_file(StringViewT path) const;
+        void dump_file(StringViewT path, const dump_options &options) const;
+
+        // compact binary image: varint counts, length-prefixed strings and an optional shared key table.
+        // throws value_error for documents nested deeper than max_depth
+        BinaryT dump_binary(bool intern_keys = true) const;
+
+        // deep comparison, maps are compared in item order
+        bool operator==(const yaml &right) const { return equal(right); }
+        bool operator!=(const yaml &right) const { return !equal(right); }
+
+        // ignore_map_order: maps with the same items in a different order are equal
+        bool equal(const yaml &right, bool ignore_map_order = false) const;
+
+        // total order: type, then size, then children/scalar bytes. returns <0, 0 or >0
+        int compare(const yaml &right) const;
+
         inline void remove(StringViewT key)
         {
+            detach();
             if (mType != value_t::map)
                 throw yaml::value_error(ulib::string{"[yaml.value_error] ulib::yaml.remove(\""} + key +
                                         "\"): node must be a map, but is " + type_to_string(mType));
 
-            for (auto it = mMap.begin(); it != mMap.end(); it++)
-            {
-                if (it->name() == key)
-                {
-                    mMap.erase(it);
-                    return;
-                }
-            }
+            if (ItemT *item = find_item(key, KeyT::hash_of(key)))
+                mMap.erase(mMap.begin() + (item - mMap.data()));
         }
 
         // inline bool is_int() const { return mType == value_t::integer; }
         // inline bool is_float() const { return mType == value_t::floating; }
-        inline bool is_scalar() const { return mType == value_t::scalar; }
-        inline bool is_sequence() const { return mType == value_t::sequence; }
-        inline bool is_map() const { return mType == value_t::map; }
+        inline bool is_scalar() const { return type() == value_t::scalar; }
+        inline bool is_sequence() const { return type() == value_t::sequence; }
+        inline bool is_map() const { return type() == value_t::map; }
         // inline bool is_number() const { return mType == value_t::integer || mType == value_t::floating; }
         // inline bool is_bool() const { return mType == value_t::boolean; }
-        inline bool is_null() const { return mType == value_t::null; }
+        inline bool is_null() const { return type() == value_t::null; }
 
     private:
+        class binary_writer;
+        class binary_reader;
+        class shared_node;
+        class table_node;
+        class table_row;
+        class event_builder;
+        class json_reader;
+        class entry_scanner;
+        class lazy_node;
+
+        // indirect nodes forward reads to a shared_node, which may build its value on first access.
+        // mutation goes through detach(), which gives the node its own copy first
+        const yaml &resolved() const { return mIndirect ? resolve_indirect() : *this; }
+        value_t indirect_type() const;
+        size_t indirect_size() const;
+        const yaml &resolve_indirect() const;
+
+        void detach()
+        {
+            if (mIndirect)
+                detach_indirect();
+        }
+
+        void detach_indirect();
+        void construct_indirect(shared_node *node);
+
         void initialize_as_string();
         void initialize_as_object();
         void initialize_as_array();
@@ -468,12 +885,68 @@ namespace ulib
         void copy_construct_from_other(const yaml &other);
         void move_construct_from_other(yaml &&other);
 
+        // other without its items or values
+        void copy_shallow(const yaml &other);
+
         void destroy_containers();
+        void destroy_nested();
+
+        // sorts the items of this map only
+        void sort_items();
+        static void sort_trees(yaml *const *nodes, size_t count);
+
+        template <class NodeT, class PassT>
+        static void traverse_passes(NodeT &root, PassT *const *passes, size_t count);
+
+        // first item not ordered before name in a sorted map
+        size_t lower_bound(StringViewT name) const;
+
+        ItemT *find_item(StringViewT name, uint64_t hash);
+        const ItemT *find_item(StringViewT name, uint64_t hash) const;
+
+        // a scalar converted to another string type, type identifies the target
+        struct conversion
+        {
+            const void *type = nullptr;
+            std::string source;
+            std::shared_ptr<const void> value;
+        };
+
+        // slot of a small per-thread cache for str, emptied if it held another string or type
+        static conversion &conversion_slot(const void *type, StringViewT str);
+
+        // scalars that need transcoding, e.g. to UTF-16, are converted once per thread while they stay in the
+        // cache. later reads of the same string copy the cached result
+        template <class T, class TEncodingT>
+        static T convert_scalar(const StringT &str)
+        {
+            if constexpr (is_encodings_raw_movable_v<EncodingT, TEncodingT>)
+                return ulib::Convert<TEncodingT>(ulib::u8(str));
+            else
+            {
+                // short strings convert faster than they hash
+                if (str.size() < 16)
+                    return ulib::Convert<TEncodingT>(ulib::u8(str));
+
+                static const char type = 0;
+                conversion &slot = conversion_slot(&type, str);
+                if (!slot.value)
+                    slot.value = std::make_shared<const T>(ulib::Convert<TEncodingT>(ulib::u8(str)));
+
+                return *static_cast<const T *>(slot.value.get());
+            }
+        }
 
         yaml *find_object_in_object(StringViewT name);
         const yaml *find_object_in_object(StringViewT name) const;
 
         value_t mType;
+        bool mIndirect = false;
+        style_t mStyle = style_t::any;
+        bool mSorted = false;
+
+        // identity of a map item once a handle_pool named it, 0 before. item moves carry it, copies don't
+        uint32_t mItemId = 0;
 
         union {
             // bool mBoolVal;
@@ -483,9 +956,13 @@ namespace ulib
             StringT mScalar;
             MapT mMap;
             SequenceT mSequence;
+            shared_node *mNode;
         };
 
-        static StringT yaml_serialize(const yaml &yml);
+        static yaml parse_yaml_json(StringViewT str, const parse_options &options);
+        static yaml parse_lazy(const std::shared_ptr<const void> &owner, StringViewT text,
+                               const parse_options &options);
+        static StringT yaml_serialize(const yaml &yml, const dump_options &options);
 
         static double parse_float(ulib::string_view str)
         {
@@ -583,4 +1060,437 @@ namespace ulib
         }
     };
 
+    // sequence of flat records with one key schema, stored as one contiguous column per key.
+    // cells keep their source text, columns whose cells are all integers or all decimals also get a typed array
+    class yaml::table
+    {
+    public:
+        enum class column_t
+        {
+            string,
+            integer,
+            floating,
+        };
+
+        class column
+        {
+        public:
+            column() : mType(column_t::string) { mOffsets.push_back(0); }
+
+            column_t type() const { return mType; }
+            size_t size() const { return mNulls.size(); }
+
+            bool is_null(size_t row) const { return mNulls[row] != 0; }
+            StringViewT scalar(size_t row) const
+            {
+                return StringViewT{mChars.data() + mOffsets[row], mOffsets[row + 1] - mOffsets[row]};
+            }
+
+            // filled when type() is integer or floating, null cells hold 0
+            span<const int64_t> integers() const { return mIntegers; }
+            span<const double> floats() const { return mFloats; }
+
+            void push_back(StringViewT cell);
+            void push_null();
+
+            // bytes of the cell storage, capacity included
+            size_t allocated() const;
+
+        private:
+            friend class table;
+
+            void infer_type();
+
+            column_t mType;
+            ulib::List<CharT, AllocatorT> mChars;
+            ulib::List<size_t, AllocatorT> mOffsets;
+            ulib::List<uint8_t, AllocatorT> mNulls;
+            ulib::List<int64_t, AllocatorT> mIntegers;
+            ulib::List<double, AllocatorT> mFloats;
+        };
+
+        table() {}
+        table(span<const KeyT> keys);
+
+        // column store of a sequence of maps that all have the same keys in the same order, at least one, and
+        // only scalar or null values, std::nullopt for anything else
+        static std::optional<table> from(const yaml &sequence);
+
+        size_t rows() const { return mColumns.empty() ? 0 : mColumns[0].size(); }
+        size_t width() const { return mKeys.size(); }
+
+        span<const KeyT> keys() const { return mKeys; }
+        span<const column> columns() const { return mColumns; }
+        column &at(size_t idx) { return mColumns[idx]; }
+        const column &at(size_t idx) const { return mColumns[idx]; }
+        const column *find(StringViewT key) const;
+
+        // computes column types, call after the last row is added
+        void freeze();
+
+        // orders the columns by key bytes, rows are then built as sorted maps
+        void sort_keys();
+
+        // bytes of the columns and the key list, not counting the key buffers
+        size_t allocated() const;
+
+        yaml row(size_t idx) const;
+        yaml to_yaml() const;
+
+    private:
+        ulib::List<KeyT, AllocatorT> mKeys;
+        ulib::List<column, AllocatorT> mColumns;
+        bool mSorted = false;
+    };
+
+    // parses a block map or block sequence document as it arrives in chunks. every top-level entry is parsed
+    // once the next one starts, so document() grows while the input is still being read. documents with
+    // anchors or a flow/JSON root are buffered and parsed by finish()
+    class yaml::stream_parser
+    {
+    public:
+        stream_parser() : stream_parser(parse_options{}) {}
+        stream_parser(const parse_options &options);
+        stream_parser(const stream_parser &) = delete;
+        ~stream_parser();
+        stream_parser &operator=(const stream_parser &) = delete;
+
+        void feed(StringViewT chunk);
+
+        // parses the rest of the input and hands out the document
+        yaml finish();
+
+        // top-level entries parsed so far
+        const yaml &document() const { return mDocument; }
+
+    private:
+        bool parse_entries(size_t from, size_t to);
+        void merge(yaml &&piece);
+
+        parse_options mOptions;
+        key_pool mKeys;
+
+        std::string mBuffer;
+        size_t mStart;
+        size_t mScan;
+        bool mIncremental;
+        bool mStarted;
+        bool mFinished;
+        bool mEnded;
+        bool mValidate;
+        size_t mValidated;
+        std::unique_ptr<entry_scanner> mScanner;
+
+        yaml mDocument;
+    };
+
+    // parses every included file once and shares its document between all includes of it, so a fragment
+    // included from many places is stored once. a cached fragment is reused while its file keeps its size and
+    // modification time or content hash, and the files it includes are current. include cycles fail the parse.
+    // fragments are parsed with the options of their first include, one resolver serves one parse at a time
+    class yaml::include_resolver
+    {
+    public:
+        include_resolver() : mGeneration(0), mParsed(0) {}
+        include_resolver(const include_resolver &) = delete;
+        ~include_resolver() { clear(); }
+        include_resolver &operator=(const include_resolver &) = delete;
+
+        // files parsed so far, includes answered from the cache don't count
+        size_t parsed() const { return mParsed; }
+
+        // drops the cached fragments, documents that include them keep them alive
+        void clear();
+
+    private:
+        friend class yaml;
+
+        // an included file and the parse of it that was used
+        struct dependency
+        {
+            std::string path;
+            size_t version;
+        };
+
+        struct fragment
+        {
+            uint64_t size = 0;
+            int64_t mtime = 0;
+            uint64_t hash = 0;
+            size_t version = 0;
+            ulib::List<dependency> includes;
+            shared_node *node = nullptr;
+
+            // validated in this generation, and the result
+            uint64_t checked = 0;
+            bool current = false;
+        };
+
+        // root document of a parse_file() with includes
+        yaml parse_root(StringViewT path, const parse_options &options);
+
+        // document of the file at path, retained for the caller
+        shared_node *load(StringViewT path, const parse_options &options);
+
+        std::string absolute_path(StringViewT path) const;
+        bool is_current(const std::string &key, fragment &entry);
+        yaml parse_in_scope(const std::string &key, StringViewT text, const parse_options &options,
+                            ulib::List<dependency> &includes);
+
+        std::unordered_map<std::string, fragment> mFragments;
+
+        // files being parsed, innermost last, with the files each one includes
+        ulib::List<std::string> mStack;
+        ulib::List<ulib::List<dependency>> mIncludes;
+
+        uint64_t mGeneration;
+        size_t mParsed;
+    };
+
+    // handles to nodes of a live document. a handle names its node by the parent handle and the key or index,
+    // so it survives items being added, moved or removed around it while references into the containers don't.
+    // get() checks the node it found last against the parent's storage, a pointer compare per level, and looks
+    // it up again only after the storage moved. a map item that is gone resolves to nullptr from then on, also
+    // after its key is set again: child() hands out a new handle for the new item. items are told apart by an
+    // id child() stamps on them, which moves with the item and isn't copied, so a copied or re-added item is
+    // another one. sequence items are named by index and resolve to whatever is at it. released handles fail
+    // the generation check. the document must stay at its address while the pool is used, and the pool is used
+    // by one thread at a time
+    class yaml::handle_pool
+    {
+    public:
+        explicit handle_pool(yaml &root);
+        handle_pool(const handle_pool &) = delete;
+        handle_pool &operator=(const handle_pool &) = delete;
+
+        node_handle root() const { return node_handle{0, 1}; }
+
+        // handle of an existing child, the same handle for the same child while it is held. a default handle
+        // if the parent or the child doesn't exist
+        node_handle child(node_handle parent, StringViewT key);
+        node_handle child(node_handle parent, size_t idx);
+
+        // the node, nullptr for a released handle or a node that is gone. mutable access detaches shared
+        // subtrees on the path like operator[] does
+        yaml *get(node_handle handle);
+
+        // the node without detaching anything, read through shared subtrees like resolved()
+        const yaml *get(node_handle handle) const;
+
+        node_handle parent(node_handle handle) const;
+        bool valid(node_handle handle) const;
+
+        // the handle and every copy of it stop resolving. its children keep working
+        void release(node_handle handle);
+
+        // handles held, the root included
+        size_t size() const { return mSlots.size() - mFree.size(); }
+
+    private:
+        struct slot
+        {
+            uint32_t parent = 0;
+            uint32_t generation = 1;
+            uint32_t children = 0;
+            bool released = false;
+
+            // sequence index or map key, and the id of the map item
+            bool item = false;
+            size_t index = 0;
+            KeyT key;
+            uint32_t id = 0;
+
+            // the map item was removed, the slot doesn't resolve again
+            bool gone = false;
+
+            // last lookup: the parent's item storage and the position in it
+            const void *storage = nullptr;
+            size_t pos = 0;
+        };
+
+        struct child_key
+        {
+            uint32_t parent;
+            bool item;
+            size_t index;
+            KeyT key;
+
+            bool operator==(const child_key &other) const
+            {
+                return parent == other.parent && item == other.item &&
+                       (item ? index == other.index : other.key.equals(key.str(), key.hash()));
+            }
+        };
+
+        struct child_hash
+        {
+            size_t operator()(const child_key &key) const
+            {
+                return size_t((key.item ? key.index : key.key.hash()) * 31 + key.parent);
+            }
+        };
+
+        node_handle add(child_key &&key);
+        yaml *resolve(uint32_t index);
+        const yaml *resolve(uint32_t index) const;
+        void recycle(uint32_t index);
+
+        yaml &mRoot;
+        ulib::List<slot> mSlots;
+        ulib::List<uint32_t> mFree;
+        std::unordered_map<child_key, uint32_t, child_hash> mChildren;
+    };
+
+    // one pass of a traversal. enter() is called before the children of a node and leave() after them, also
+    // when enter() returned false to skip them. nodes are passed as they are stored, so an alias can be told
+    // apart by its shared_id() and its subtree is walked once per alias unless enter() skips it. the walk
+    // doesn't recurse, the depth of a document is only limited by memory. dump() is limited to max_depth
+    class yaml::visitor
+    {
+    public:
+        virtual ~visitor() {}
+
+        virtual bool enter(const yaml &, const visit_info &) { return true; }
+        virtual void leave(const yaml &, const visit_info &) {}
+    };
+
+    // a pass that may change the nodes it is given, like operator[] shared subtrees are detached on the way.
+    // enter() may replace the node, its new children are walked. neither call may change the node's parent
+    // or siblings
+    class yaml::transformer
+    {
+    public:
+        virtual ~transformer() {}
+
+        virtual bool enter(yaml &, const visit_info &) { return true; }
+        virtual void leave(yaml &, const visit_info &) {}
+    };
+
+    // compiled path expression, a subset of JSONPath that also takes yq paths:
+    //   $ or .            the root, may be left out
+    //   .name ['name']    the value of a map item
+    //   [n]               a sequence value, negative indices count from the end
+    //   [a:b:s]           a slice of a sequence, any part may be left out
+    //   [x,y]             several names, indices or slices
+    //   .* [*]            every value of a map or sequence
+    //   ..name ..* ..[n]  the same at any depth
+    //   [?(expr)]         the values for which expr holds. expr compares paths from @ (the value) or $ (the
+    //                     root) with ==, !=, <, <=, >, >= to other paths, numbers, 'strings', true, false and
+    //                     null, and combines comparisons with &&, || and !. a path on its own tests that it exists
+    // a compiled query is immutable and can be used by several threads at once. results point into the
+    // document and stay valid until it is changed
+    class yaml::query
+    {
+    public:
+        explicit query(StringViewT expression);
+
+        // matching nodes in document order. steps with many inputs, like a filter over a long sequence, are
+        // split between up to threads threads, 0 uses every core
+        ulib::List<const yaml *> select(const yaml &root, size_t threads = 1) const;
+
+        // first match, nullptr if there is none
+        const yaml *first(const yaml &root) const;
+
+        StringViewT expression() const { return mExpression; }
+
+    private:
+        class parser;
+
+        enum class step_t : uint8_t
+        {
+            name,
+            index,
+            slice,
+            children,
+            descend,
+            filter,
+            group,
+        };
+
+        // group: the steps first..first+count applied to the same input, the selectors of one bracket
+        struct step
+        {
+            explicit step(step_t type) : kind(type) {}
+
+            step_t kind;
+            bool has_start = false;
+            bool has_end = false;
+            int64_t start = 0;
+            int64_t end = 0;
+            int64_t stride = 1;
+            StringT name;
+            uint64_t hash = 0;
+            size_t first = 0;
+            size_t count = 0;
+            size_t expr = 0;
+        };
+
+        enum class operand_t : uint8_t
+        {
+            current,
+            root,
+            number,
+            string,
+            boolean,
+            null,
+        };
+
+        // paths are the steps first..first+count, singular if they only name items and indices
+        struct operand
+        {
+            explicit operand(operand_t type) : kind(type) {}
+
+            operand_t kind;
+            bool singular = true;
+            size_t first = 0;
+            size_t count = 0;
+            double number = 0;
+            StringT text;
+            bool boolean = false;
+        };
+
+        enum class expr_t : uint8_t
+        {
+            any,
+            all,
+            negate,
+            exists,
+            equal,
+            not_equal,
+            less,
+            less_equal,
+            greater,
+            greater_equal,
+        };
+
+        // any/all: the expressions left and right, negate: left, exists: operand left, comparisons: operands
+        struct expr
+        {
+            expr_t kind;
+            size_t left = 0;
+            size_t right = 0;
+        };
+
+        struct value;
+
+        void run(size_t first, size_t count, const yaml &root, ulib::List<const yaml *> &nodes,
+                 size_t threads) const;
+        void apply(const step &s, const yaml &node, const yaml &root, ulib::List<const yaml *> &out) const;
+        void filter(const step &s, const ulib::List<const yaml *> &nodes, const yaml &root,
+                    ulib::List<const yaml *> &out, size_t threads) const;
+        bool scan_table(const step &s, const yaml &node, ulib::List<const yaml *> &out) const;
+
+        bool test(size_t idx, const yaml &node, const yaml &root) const;
+        value evaluate(const operand &o, const yaml &node, const yaml &root) const;
+
+        StringT mExpression;
+
+        // the query is the steps mFirst..mFirst+mLength, after the steps of the paths in its filters
+        ulib::List<step> mSteps;
+        size_t mFirst = 0;
+        size_t mLength = 0;
+        ulib::List<expr> mExprs;
+        ulib::List<operand> mOperands;
+    };
+
 } // namespace ulib
\ No newline at end of file
@@ -0,0 +1,404 @@
+#include "yaml.h"
+#include "yaml_detail.h"
+
+#include <cstring>
+#include <string_view>
+#include <unordered_map>
+
+// layout, all integers little-endian:
+//   header:  "ULYB" | u16 version | u16 flags | u64 payload size | u64 fnv1a(payload)
+//   payload: [varint key count, keys...] node
+//   node:    u8 tag, then
+//            scalar   - varint size, bytes
+//            sequence - varint count, nodes
+//            map      - varint count, (key, node) pairs; key is a varint index into the key table
+//                       when kFlagKeyTable is set, a length-prefixed string otherwise
+//            anchor   - node; a shared subtree, numbered in order of appearance
+//            alias    - varint anchor number
+
+namespace ulib
+{
+    namespace yaml_detail
+    {
+        constexpr uint8_t kBinaryMagic[4] = {'U', 'L', 'Y', 'B'};
+        constexpr uint16_t kBinaryVersion = 2;
+        constexpr uint16_t kFlagKeyTable = 1;
+        constexpr size_t kBinaryHeaderSize = 24;
+
+        enum binary_tag : uint8_t
+        {
+            tag_null = 0,
+            tag_scalar = 1,
+            tag_sequence = 2,
+            tag_map = 3,
+            tag_anchor = 4,
+            tag_alias = 5,
+        };
+
+        inline void store_le(uint8_t *out, uint64_t v, size_t bytes)
+        {
+            for (size_t i = 0; i != bytes; i++)
+                out[i] = uint8_t(v >> (i * 8));
+        }
+
+        inline uint64_t load_le(const uint8_t *in, size_t bytes)
+        {
+            uint64_t v = 0;
+            for (size_t i = 0; i != bytes; i++)
+                v |= uint64_t(in[i]) << (i * 8);
+            return v;
+        }
+    } // namespace yaml_detail
+
+    using BinaryT = typename yaml::BinaryT;
+
+    class yaml::binary_writer
+    {
+    public:
+        binary_writer(bool intern_keys) : mInternKeys(intern_keys), mKeyCount(0) {}
+
+        void write_node(const yaml &node, size_t depth = 0)
+        {
+            if (depth > yaml::max_depth)
+                throw yaml::value_error{ulib::string{"[yaml.value_error] ulib::yaml.dump_binary(): document nested "
+                                                     "deeper than "} +
+                                        std::to_string(yaml::max_depth) + " levels"};
+
+            // a node nothing else refers to can't be aliased, table rows and lazy values are written inline.
+            // so are included documents, as dump() writes them
+            if (node.mIndirect && node.mNode->refs() > 1 && !node.mNode->inlined())
+            {
+                auto result = mShared.emplace(node.mNode, mShared.size());
+                if (!result.second)
+                {
+                    put(yaml_detail::tag_alias);
+                    put_varint(result.first->second, mBody);
+                    return;
+                }
+
+                put(yaml_detail::tag_anchor);
+            }
+
+            auto &yml = node.resolved();
+            switch (yml.mType)
+            {
+            case value_t::null:
+                put(yaml_detail::tag_null);
+                return;
+
+            case value_t::scalar:
+                put(yaml_detail::tag_scalar);
+                put_string(yml.mScalar, mBody);
+                return;
+
+            case value_t::sequence:
+                put(yaml_detail::tag_sequence);
+                put_varint(yml.mSequence.size(), mBody);
+                for (auto &val : yml.mSequence)
+                    write_node(val, depth + 1);
+                return;
+
+            case value_t::map:
+                put(yaml_detail::tag_map);
+                put_varint(yml.mMap.size(), mBody);
+                for (auto &itm : yml.mMap)
+                {
+                    put_key(itm.name());
+                    write_node(itm.value(), depth + 1);
+                }
+                return;
+            }
+
+            throw yaml::internal_error{"[yaml.internal_error] ulib::yaml.dump_binary(): got invalid yaml type " +
+                                       std::to_string((int)yml.mType)};
+        }
+
+        BinaryT finish()
+        {
+            BinaryT keyCount;
+            if (mInternKeys)
+                put_varint(mKeyCount, keyCount);
+
+            size_t payloadSize = keyCount.size() + mKeys.size() + mBody.size();
+
+            BinaryT result;
+            result.resize(yaml_detail::kBinaryHeaderSize + payloadSize);
+
+            uint8_t *out = result.data();
+            uint8_t *payload = out + yaml_detail::kBinaryHeaderSize;
+            uint8_t *it = payload;
+
+            for (auto *part : {&keyCount, &mKeys, &mBody})
+            {
+                if (part->size())
+                    std::memcpy(it, part->data(), part->size());
+                it += part->size();
+            }
+
+            std::memcpy(out, yaml_detail::kBinaryMagic, 4);
+            yaml_detail::store_le(out + 4, yaml_detail::kBinaryVersion, 2);
+            yaml_detail::store_le(out + 6, mInternKeys ? yaml_detail::kFlagKeyTable : 0, 2);
+            yaml_detail::store_le(out + 8, payloadSize, 8);
+            yaml_detail::store_le(out + 16, yaml_detail::fnv1a(payload, payloadSize), 8);
+
+            return result;
+        }
+
+    private:
+        void put(uint8_t v) { mBody.push_back(v); }
+
+        static void put_varint(uint64_t v, BinaryT &out)
+        {
+            while (v >= 0x80)
+            {
+                out.push_back(uint8_t(v) | 0x80);
+                v >>= 7;
+            }
+
+            out.push_back(uint8_t(v));
+        }
+
+        static void put_string(StringViewT str, BinaryT &out)
+        {
+            put_varint(str.size(), out);
+            if (str.size() == 0)
+                return;
+
+            size_t at = out.size();
+            out.resize(at + str.size());
+            std::memcpy(out.data() + at, str.data(), str.size());
+        }
+
+        void put_key(StringViewT name)
+        {
+            if (!mInternKeys)
+                return put_string(name, mBody);
+
+            auto result = mKeyIds.emplace(std::string_view{name.data(), name.size()}, mKeyCount);
+            if (result.second)
+            {
+                put_string(name, mKeys);
+                mKeyCount++;
+            }
+
+            put_varint(result.first->second, mBody);
+        }
+
+        bool mInternKeys;
+        uint64_t mKeyCount;
+        std::unordered_map<std::string_view, uint64_t> mKeyIds;
+        std::unordered_map<const shared_node *, uint64_t> mShared;
+        BinaryT mKeys;
+        BinaryT mBody;
+    };
+
+    class yaml::binary_reader
+    {
+    public:
+        binary_reader(const uint8_t *begin, const uint8_t *end) : mIt(begin), mEnd(end) {}
+
+        ~binary_reader()
+        {
+            for (auto node : mShared)
+                node->release();
+        }
+
+        void read_key_table()
+        {
+            uint64_t count = get_count();
+            mKeys.reserve(count);
+
+            for (uint64_t i = 0; i != count; i++)
+                mKeys.push_back(KeyT{get_string()});
+        }
+
+        void read_node(yaml &dest, size_t depth = 0)
+        {
+            if (depth > yaml::max_depth)
+                fail("document nested too deep");
+
+            switch (get())
+            {
+            case yaml_detail::tag_null:
+                return;
+
+            case yaml_detail::tag_scalar:
+                dest.construct_as_string(get_string());
+                return;
+
+            case yaml_detail::tag_sequence: {
+                uint64_t count = get_count();
+
+                dest.initialize_as_array();
+                dest.mSequence.reserve(count);
+                for (uint64_t i = 0; i != count; i++)
+                    read_node(dest.mSequence.emplace_back(), depth + 1);
+
+                return;
+            }
+
+            case yaml_detail::tag_map: {
+                uint64_t count = get_count();
+
+                dest.initialize_as_object();
+                dest.mMap.reserve(count);
+                for (uint64_t i = 0; i != count; i++)
+                    read_node(dest.mMap.emplace_back(get_key()).value(), depth + 1);
+
+                return;
+            }
+
+            case yaml_detail::tag_anchor: {
+                // the writer puts the value itself after an anchor, a chain of them would recurse without depth
+                if (mIt != mEnd && (*mIt == yaml_detail::tag_anchor || *mIt == yaml_detail::tag_alias))
+                    fail("anchor of an anchor or alias");
+
+                yaml value;
+                read_node(value, depth);
+
+                shared_node *node = new shared_node{std::move(value)};
+                mShared.push_back(node);
+                node->retain();
+                dest.construct_indirect(node);
+                return;
+            }
+
+            case yaml_detail::tag_alias: {
+                uint64_t idx = get_varint();
+                if (idx >= mShared.size())
+                    fail("alias to an unknown anchor");
+
+                mShared[size_t(idx)]->retain();
+                dest.construct_indirect(mShared[size_t(idx)]);
+                return;
+            }
+
+            default:
+                fail("invalid node tag");
+            }
+        }
+
+        bool at_end() const { return mIt == mEnd; }
+
+    private:
+        [[noreturn]] static void fail(const char *what)
+        {
+            throw yaml::parse_error{ulib::string{"[yaml.parse_error] ulib::yaml::load_binary(): "} + what};
+        }
+
+        uint8_t get()
+        {
+            if (mIt == mEnd)
+                fail("unexpected end of data");
+
+            return *mIt++;
+        }
+
+        uint64_t get_varint()
+        {
+            uint64_t result = 0;
+            for (size_t shift = 0; shift < 64; shift += 7)
+            {
+                uint8_t b = get();
+                result |= uint64_t(b & 0x7F) << shift;
+                if (!(b & 0x80))
+                    return result;
+            }
+
+            fail("malformed varint");
+        }
+
+        // every counted element takes at least one byte, which bounds reserve() on corrupted input
+        uint64_t get_count()
+        {
+            uint64_t count = get_varint();
+            if (count > uint64_t(mEnd - mIt))
+                fail("element count exceeds data size");
+
+            return count;
+        }
+
+        StringViewT get_string()
+        {
+            uint64_t size = get_varint();
+            if (size > uint64_t(mEnd - mIt))
+                fail("string size exceeds data size");
+
+            StringViewT result{(const CharT *)mIt, size_t(size)};
+            mIt += size;
+            return result;
+        }
+
+        // table keys are shared by every item that uses them
+        KeyT get_key()
+        {
+            if (mKeys.empty())
+                return KeyT{get_string()};
+
+            uint64_t idx = get_varint();
+            if (idx >= mKeys.size())
+                fail("key index out of range");
+
+            return mKeys[size_t(idx)];
+        }
+
+        const uint8_t *mIt;
+        const uint8_t *mEnd;
+        ulib::List<KeyT> mKeys;
+        ulib::List<shared_node *> mShared;
+    };
+
+    BinaryT yaml::dump_binary(bool intern_keys) const
+    {
+        binary_writer writer{intern_keys};
+        writer.write_node(*this);
+        return writer.finish();
+    }
+
+    yaml yaml::load_binary(const void *data, size_t size)
+    {
+        auto begin = (const uint8_t *)data;
+
+        if (size < yaml_detail::kBinaryHeaderSize || std::memcmp(begin, yaml_detail::kBinaryMagic, 4) != 0)
+            throw yaml::parse_error{"[yaml.parse_error] ulib::yaml::load_binary(): not a binary yaml image"};
+
+        uint64_t version = yaml_detail::load_le(begin + 4, 2);
+        if (version != yaml_detail::kBinaryVersion)
+            throw yaml::parse_error{ulib::string{"[yaml.parse_error] ulib::yaml::load_binary(): unsupported version "} +
+                                    std::to_string(version)};
+
+        uint64_t flags = yaml_detail::load_le(begin + 6, 2);
+        uint64_t payloadSize = yaml_detail::load_le(begin + 8, 8);
+        uint64_t checksum = yaml_detail::load_le(begin + 16, 8);
+
+        const uint8_t *payload = begin + yaml_detail::kBinaryHeaderSize;
+        if (payloadSize != size - yaml_detail::kBinaryHeaderSize)
+            throw yaml::parse_error{"[yaml.parse_error] ulib::yaml::load_binary(): payload size mismatch"};
+
+        if (yaml_detail::fnv1a(payload, size_t(payloadSize)) != checksum)
+            throw yaml::parse_error{"[yaml.parse_error] ulib::yaml::load_binary(): checksum mismatch"};
+
+        binary_reader reader{payload, payload + payloadSize};
+        if (flags & yaml_detail::kFlagKeyTable)
+            reader.read_key_table();
+
+        yaml result;
+        reader.read_node(result);
+
+        if (!reader.at_end())
+            throw yaml::parse_error{"[yaml.parse_error] ulib::yaml::load_binary(): trailing data after root node"};
+
+        return result;
+    }
+
+    yaml yaml::load_binary_file(StringViewT path)
+    {
+        yaml_detail::mapped_file file;
+        if (!file.open(path))
+            throw yaml::exception{ulib::string{"[yaml.exception] ulib::yaml::load_binary_file(\""} + path +
+                                  "\"): can't open file"};
+
+        return load_binary(file.data(), file.size());
+    }
+
+} // namespace ulib
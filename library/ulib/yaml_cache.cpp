@@ -0,0 +1,191 @@
+#include "yaml.h"
+#include "yaml_detail.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+// cache entry: "ULYC" | u64 source size | i64 source mtime | u64 fnv1a(source) | binary image (see yaml_binary.cpp)
+
+namespace ulib
+{
+    namespace yaml_detail
+    {
+        namespace fs = std::filesystem;
+
+        constexpr uint8_t kCacheMagic[4] = {'U', 'L', 'Y', 'C'};
+        constexpr size_t kCacheHeaderSize = 28;
+
+        struct cache_key
+        {
+            uint64_t size;
+            int64_t mtime;
+            uint64_t hash;
+        };
+
+        inline void store_u64(uint8_t *out, uint64_t v)
+        {
+            for (size_t i = 0; i != 8; i++)
+                out[i] = uint8_t(v >> (i * 8));
+        }
+
+        inline uint64_t load_u64(const uint8_t *in)
+        {
+            uint64_t v = 0;
+            for (size_t i = 0; i != 8; i++)
+                v |= uint64_t(in[i]) << (i * 8);
+            return v;
+        }
+
+        uint64_t process_id()
+        {
+#ifdef _WIN32
+            return uint64_t(GetCurrentProcessId());
+#else
+            return uint64_t(getpid());
+#endif
+        }
+
+        fs::path cache_entry_path(const fs::path &source, const fs::path &cacheDir)
+        {
+            std::error_code ec;
+            fs::path absolute = fs::absolute(source, ec);
+            if (ec)
+                absolute = source;
+
+            std::string key = absolute.lexically_normal().generic_string();
+            uint64_t hash = fnv1a(key.data(), key.size());
+
+            char name[32];
+            snprintf(name, sizeof(name), "%016llx.ybin", (unsigned long long)hash);
+            return cacheDir / name;
+        }
+
+        // writes into a process and thread unique temporary file, then renames it over the entry,
+        // so readers see either the old or the new entry, never a partial one
+        void write_cache_entry(const fs::path &entry, const cache_key &key, const yaml::BinaryT &image)
+        {
+            static std::atomic<uint64_t> counter{0};
+
+            char suffix[64];
+            snprintf(suffix, sizeof(suffix), ".%llx.%llx.%llx.tmp", (unsigned long long)process_id(),
+                     (unsigned long long)std::hash<std::thread::id>{}(std::this_thread::get_id()),
+                     (unsigned long long)counter++);
+
+            fs::path tmp = entry;
+            tmp += suffix;
+
+            uint8_t header[kCacheHeaderSize];
+            std::memcpy(header, kCacheMagic, 4);
+            store_u64(header + 4, key.size);
+            store_u64(header + 12, uint64_t(key.mtime));
+            store_u64(header + 20, key.hash);
+
+            {
+                std::ofstream out{tmp, std::ios::binary | std::ios::trunc};
+                if (!out)
+                    return;
+
+                out.write((const char *)header, sizeof(header));
+                out.write((const char *)image.data(), std::streamsize(image.size()));
+                if (!out)
+                {
+                    out.close();
+                    std::error_code ec;
+                    fs::remove(tmp, ec);
+                    return;
+                }
+            }
+
+            std::error_code ec;
+            fs::rename(tmp, entry, ec);
+            if (ec)
+                fs::remove(tmp, ec);
+        }
+    } // namespace yaml_detail
+
+    yaml yaml::parse_file_cached(StringViewT path, StringViewT cache_dir)
+    {
+        namespace fs = std::filesystem;
+
+        fs::path source{std::string{path.data(), path.size()}};
+        fs::path cacheDir{std::string{cache_dir.data(), cache_dir.size()}};
+
+        std::error_code ec;
+        uint64_t size = fs::file_size(source, ec);
+        if (ec)
+            return parse_file(path); // reports the missing file
+
+        int64_t mtime = int64_t(fs::last_write_time(source, ec).time_since_epoch().count());
+        if (ec)
+            return parse_file(path);
+
+        fs::path entryPath = yaml_detail::cache_entry_path(source, cacheDir);
+
+        std::string entryString = entryPath.string();
+
+        yaml_detail::mapped_file entry;
+        bool haveEntry = entry.open(ulib::string_view{entryString.data(), entryString.size()}) &&
+                         entry.size() >= yaml_detail::kCacheHeaderSize &&
+                         std::memcmp(entry.data(), yaml_detail::kCacheMagic, 4) == 0;
+
+        yaml_detail::cache_key stored{};
+        if (haveEntry)
+        {
+            stored.size = yaml_detail::load_u64(entry.data() + 4);
+            stored.mtime = int64_t(yaml_detail::load_u64(entry.data() + 12));
+            stored.hash = yaml_detail::load_u64(entry.data() + 20);
+        }
+
+        auto try_load_entry = [&](yaml &out) {
+            try
+            {
+                out = load_binary(entry.data() + yaml_detail::kCacheHeaderSize,
+                                  entry.size() - yaml_detail::kCacheHeaderSize);
+                return true;
+            }
+            catch (const yaml::parse_error &)
+            {
+                // corrupted or written by an incompatible version, parse and replace it
+                return false;
+            }
+        };
+
+        yaml result;
+        if (haveEntry && stored.size == size && stored.mtime == mtime && try_load_entry(result))
+            return result;
+
+        yaml_detail::mapped_file file;
+        if (!file.open(path))
+            throw yaml::exception{ulib::string{"[yaml.exception] ulib::yaml::parse_file_cached(\""} + path +
+                                  "\"): can't open file"};
+
+        yaml_detail::cache_key key{file.size(), mtime, yaml_detail::fnv1a(file.data(), file.size())};
+
+        // touched but unchanged source: reuse the image and refresh the entry's mtime
+        bool reuse = haveEntry && stored.size == key.size && stored.hash == key.hash && try_load_entry(result);
+        if (!reuse)
+            result = parse(StringViewT{(const CharT *)file.data(), file.size()});
+
+        auto image = result.dump_binary();
+        entry.close();
+
+        fs::create_directories(cacheDir, ec);
+        yaml_detail::write_cache_entry(entryPath, key, image);
+
+        return result;
+    }
+
+} // namespace ulib
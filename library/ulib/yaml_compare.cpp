@@ -0,0 +1,201 @@
+#include "yaml.h"
+#include "yaml_detail.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace ulib
+{
+    namespace yaml_detail
+    {
+        using StringViewT = typename yaml::StringViewT;
+        using ItemT = typename yaml::ItemT;
+        using value_t = typename yaml::value_t;
+
+        inline bool equal_bytes(StringViewT left, StringViewT right)
+        {
+            return left.size() == right.size() &&
+                   (left.size() == 0 || std::memcmp(left.data(), right.data(), left.size()) == 0);
+        }
+
+        using pair_list = ulib::List<std::pair<const yaml *, const yaml *>>;
+
+        // the tails must hold the same keys, their values are added to pending
+        bool equal_items_unordered(span<const ItemT> left, span<const ItemT> right, size_t from, pair_list &pending)
+        {
+            // sort both tails by key, then walk them in lockstep: n log n instead of n^2 lookups
+            ulib::List<const ItemT *> ls, rs;
+            for (size_t i = from; i != left.size(); i++)
+            {
+                ls.push_back(&left[i]);
+                rs.push_back(&right[i]);
+            }
+
+            auto less = [](const ItemT *a, const ItemT *b) { return compare_bytes(a->name(), b->name()) < 0; };
+            std::sort(ls.begin(), ls.end(), less);
+            std::sort(rs.begin(), rs.end(), less);
+
+            for (size_t i = 0; i != ls.size(); i++)
+            {
+                if (!equal_bytes(ls[i]->name(), rs[i]->name()))
+                    return false;
+
+                pending.emplace_back(&ls[i]->value(), &rs[i]->value());
+            }
+
+            return true;
+        }
+    } // namespace yaml_detail
+
+    bool yaml::equal(const yaml &right, bool ignore_map_order) const
+    {
+        // children are compared from a list of pending pairs, a deep document doesn't recurse
+        yaml_detail::pair_list pending;
+        const yaml *l = this;
+        const yaml *r = &right;
+
+        while (true)
+        {
+            // indirect nodes that share a target are equal without a walk
+            if (l != r && (l->mIndirect || r->mIndirect))
+            {
+                l = &l->resolved();
+                r = &r->resolved();
+            }
+
+            if (l != r)
+            {
+                if (l->mType != r->mType)
+                    return false;
+
+                switch (l->mType)
+                {
+                case value_t::null:
+                    break;
+
+                case value_t::scalar:
+                    if (!yaml_detail::equal_bytes(l->mScalar, r->mScalar))
+                        return false;
+                    break;
+
+                case value_t::sequence:
+                    if (l->mSequence.size() != r->mSequence.size())
+                        return false;
+
+                    for (size_t i = 0; i != l->mSequence.size(); i++)
+                        pending.emplace_back(&l->mSequence[i], &r->mSequence[i]);
+                    break;
+
+                case value_t::map: {
+                    if (l->mMap.size() != r->mMap.size())
+                        return false;
+
+                    // fast path: same key order, which is the common case for documents of one origin
+                    for (size_t i = 0; i != l->mMap.size(); i++)
+                    {
+                        auto &li = l->mMap[i];
+                        auto &ri = r->mMap[i];
+
+                        if (!yaml_detail::equal_bytes(li.name(), ri.name()))
+                        {
+                            if (!ignore_map_order ||
+                                !yaml_detail::equal_items_unordered(l->mMap, r->mMap, i, pending))
+                                return false;
+                            break;
+                        }
+
+                        pending.emplace_back(&li.value(), &ri.value());
+                    }
+                    break;
+                }
+
+                default:
+                    throw yaml::internal_error{"[yaml.internal_error] ulib::yaml.equal(): got invalid yaml type " +
+                                               std::to_string((int)l->mType)};
+                }
+            }
+
+            if (pending.empty())
+                return true;
+
+            l = pending.back().first;
+            r = pending.back().second;
+            pending.pop_back();
+        }
+    }
+
+    int yaml::compare(const yaml &right) const
+    {
+        // values in document order from a list, the last one is next. an item's name is compared right before
+        // its value, after everything under the item before it
+        struct pending_value
+        {
+            const yaml *left;
+            const yaml *right;
+            bool named;
+        };
+
+        ulib::List<pending_value> pending;
+        pending.push_back(pending_value{this, &right, false});
+
+        while (!pending.empty())
+        {
+            pending_value next = pending.back();
+            pending.pop_back();
+
+            const yaml *l = next.left;
+            const yaml *r = next.right;
+            if (next.named)
+                if (int c = yaml_detail::compare_bytes(static_cast<const ItemT *>(l)->name(),
+                                                       static_cast<const ItemT *>(r)->name()))
+                    return c;
+
+            if (l != r && (l->mIndirect || r->mIndirect))
+            {
+                l = &l->resolved();
+                r = &r->resolved();
+            }
+
+            if (l == r)
+                continue;
+
+            if (l->mType != r->mType)
+                return int(l->mType) < int(r->mType) ? -1 : 1;
+
+            switch (l->mType)
+            {
+            case value_t::null:
+                break;
+
+            case value_t::scalar:
+                if (int c = yaml_detail::compare_bytes(l->mScalar, r->mScalar))
+                    return c;
+                break;
+
+            case value_t::sequence:
+                if (l->mSequence.size() != r->mSequence.size())
+                    return l->mSequence.size() < r->mSequence.size() ? -1 : 1;
+
+                for (size_t i = l->mSequence.size(); i-- != 0;)
+                    pending.push_back(pending_value{&l->mSequence[i], &r->mSequence[i], false});
+                break;
+
+            case value_t::map:
+                if (l->mMap.size() != r->mMap.size())
+                    return l->mMap.size() < r->mMap.size() ? -1 : 1;
+
+                for (size_t i = l->mMap.size(); i-- != 0;)
+                    pending.push_back(pending_value{&l->mMap[i], &r->mMap[i], true});
+                break;
+
+            default:
+                throw yaml::internal_error{"[yaml.internal_error] ulib::yaml.compare(): got invalid yaml type " +
+                                           std::to_string((int)l->mType)};
+            }
+        }
+
+        return 0;
+    }
+
+} // namespace ulib
@@ -0,0 +1,422 @@
+#pragma once
+
+#include "yaml.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
+
+namespace ulib
+{
+    namespace yaml_detail
+    {
+        constexpr uint64_t kFnvOffsetBasis = 14695981039346656037ull;
+        constexpr uint64_t kFnvPrime = 1099511628211ull;
+
+        inline uint64_t fnv1a(const void *data, size_t size, uint64_t hash = kFnvOffsetBasis)
+        {
+            auto it = (const uint8_t *)data;
+            auto end = it + size;
+
+            for (; it != end; it++)
+                hash = (hash ^ *it) * kFnvPrime;
+
+            return hash;
+        }
+
+        // hint that data is read soon, nothing where the compiler has no prefetch instruction
+        inline void prefetch(const void *data)
+        {
+#if defined(__GNUC__) || defined(__clang__)
+            __builtin_prefetch(data);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+            _mm_prefetch((const char *)data, _MM_HINT_T0);
+#else
+            (void)data;
+#endif
+        }
+
+        // [-]digits, short enough not to overflow int64_t
+        inline bool is_integer_text(yaml::StringViewT str)
+        {
+            auto it = str.data();
+            auto end = it + str.size();
+
+            if (it != end && *it == '-')
+                it++;
+
+            if (it == end || end - it > 18)
+                return false;
+
+            for (; it != end; it++)
+                if (!(*it >= '0' && *it <= '9'))
+                    return false;
+
+            return true;
+        }
+
+        // [-]digits[.digits], the subset yaml::parse_float() reads exactly
+        inline bool is_decimal_text(yaml::StringViewT str)
+        {
+            auto it = str.data();
+            auto end = it + str.size();
+
+            if (it != end && *it == '-')
+                it++;
+
+            auto digits = it;
+            while (it != end && *it >= '0' && *it <= '9')
+                it++;
+
+            if (it == digits || it - digits > 18)
+                return false;
+
+            if (it == end)
+                return true;
+
+            if (*it != '.' || ++it == end)
+                return false;
+
+            for (; it != end; it++)
+                if (!(*it >= '0' && *it <= '9'))
+                    return false;
+
+            return true;
+        }
+
+        // byte-wise order, a prefix sorts first
+        inline int compare_bytes(yaml::StringViewT left, yaml::StringViewT right)
+        {
+            size_t lsize = left.size();
+            size_t rsize = right.size();
+
+            size_t common = lsize < rsize ? lsize : rsize;
+            if (common != 0)
+                if (int r = std::memcmp(left.data(), right.data(), common))
+                    return r;
+
+            return lsize < rsize ? -1 : (lsize > rsize ? 1 : 0);
+        }
+
+        // first significant character is '{' or '['
+        inline bool starts_like_json(yaml::StringViewT str)
+        {
+            auto it = str.data();
+            auto end = it + str.size();
+
+            if (end - it >= 3 && uint8_t(it[0]) == 0xEF && uint8_t(it[1]) == 0xBB && uint8_t(it[2]) == 0xBF)
+                it += 3;
+
+            while (it != end && (*it == ' ' || *it == '\n' || *it == '\r' || *it == '\t'))
+                it++;
+
+            return it != end && (*it == '{' || *it == '[');
+        }
+
+        // -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?, the number grammar of JSON
+        inline bool is_json_number(yaml::StringViewT str)
+        {
+            auto it = str.data();
+            auto end = it + str.size();
+
+            auto digits = [&]() {
+                auto from = it;
+                while (it != end && *it >= '0' && *it <= '9')
+                    it++;
+                return it - from;
+            };
+
+            if (it != end && *it == '-')
+                it++;
+
+            if (it != end && *it == '0')
+                it++;
+            else if (digits() == 0)
+                return false;
+
+            if (it != end && *it == '.')
+            {
+                it++;
+                if (digits() == 0)
+                    return false;
+            }
+
+            if (it != end && (*it == 'e' || *it == 'E'))
+            {
+                it++;
+                if (it != end && (*it == '+' || *it == '-'))
+                    it++;
+                if (digits() == 0)
+                    return false;
+            }
+
+            return it == end;
+        }
+
+        // read-only view of a whole file, memory mapped where the platform allows it
+        class mapped_file
+        {
+        public:
+            mapped_file() : mData(nullptr), mSize(0), mHandle(nullptr), mMapping(nullptr) {}
+            mapped_file(const mapped_file &) = delete;
+            ~mapped_file() { close(); }
+
+            mapped_file &operator=(const mapped_file &) = delete;
+
+            // returns false if the file can't be opened
+            bool open(ulib::string_view path);
+            void close();
+
+            const uint8_t *data() const { return mData; }
+            size_t size() const { return mSize; }
+
+        private:
+            const uint8_t *mData;
+            size_t mSize;
+            void *mHandle;
+            void *mMapping;
+        };
+
+        // replaces ${NAME} and ${NAME:-default} with environment variables and $${ with ${. returns false with
+        // the name in missing for an unset variable without a default
+        bool expand_env(yaml::StringViewT str, yaml::StringT &out, yaml::StringT &missing);
+
+        // length of the UTF-8 sequence at it: 0 if it is invalid, -1 if it is cut off by end
+        int utf8_sequence(const char *it, const char *end);
+
+        // offset of the first invalid UTF-8 sequence, size if there is none. complete is the end of the last whole
+        // sequence, a sequence cut off at the end is only invalid once no more input follows
+        size_t validate_utf8(const char *data, size_t size, size_t &complete);
+
+        // throws parse_error naming fn for input that isn't UTF-8
+        void require_utf8(yaml::StringViewT str, const char *fn);
+
+        template <class StringT>
+        inline void append_utf8(StringT &out, uint32_t cp)
+        {
+            if (cp < 0x80)
+            {
+                out.push_back(char(cp));
+            }
+            else if (cp < 0x800)
+            {
+                out.push_back(char(0xC0 | cp >> 6));
+                out.push_back(char(0x80 | (cp & 0x3F)));
+            }
+            else if (cp < 0x10000)
+            {
+                out.push_back(char(0xE0 | cp >> 12));
+                out.push_back(char(0x80 | (cp >> 6 & 0x3F)));
+                out.push_back(char(0x80 | (cp & 0x3F)));
+            }
+            else
+            {
+                out.push_back(char(0xF0 | cp >> 18));
+                out.push_back(char(0x80 | (cp >> 12 & 0x3F)));
+                out.push_back(char(0x80 | (cp >> 6 & 0x3F)));
+                out.push_back(char(0x80 | (cp & 0x3F)));
+            }
+        }
+
+        enum class input_encoding
+        {
+            utf8,
+            utf16le,
+            utf16be,
+            utf32le,
+            utf32be,
+        };
+
+        // encoding of a document from its byte order mark or the null bytes around its first character. bom is
+        // the size of the mark
+        input_encoding detect_encoding(const char *data, size_t size, size_t &bom);
+        const char *encoding_name(input_encoding encoding);
+
+        // UTF-16 or UTF-32 input without its byte order mark as UTF-8, in one pass. false with the offset of the
+        // first invalid unit in error
+        bool transcode_to_utf8(input_encoding encoding, const char *data, size_t size, std::string &out,
+                               size_t &error);
+
+        // contents of a quoted scalar on one line, begin and end include the quotes. false for what only the
+        // parser reads: line breaks, unknown escapes, an unterminated quote
+        bool decode_quoted(const char *begin, const char *end, yaml::StringT &out);
+
+    } // namespace yaml_detail
+
+    // finds the lines that start top-level entries of a block map or block sequence document: lines at column 0
+    // outside quoted scalars, flow collections, comments and block scalars. the state carries over between
+    // calls, so the input can arrive in pieces
+    class yaml::entry_scanner
+    {
+    public:
+        // advances pos through data[0, size) and returns true with pos at the start of the next entry line.
+        // false means pos stopped at the end or at a byte that can only be decided with more input. with final
+        // set the input is complete and only the end stops it
+        bool next(const char *data, size_t size, size_t &pos, bool final);
+
+        // an anchor was seen before pos
+        bool anchors() const { return mAnchors; }
+
+        // next() stopped at a document marker that ends the first document, the rest isn't part of it
+        bool ended() const { return mEnded; }
+
+        // a line at column 0 before pos doesn't start an entry: a key without ':' or a line that ends a sequence,
+        // or a quote or flow collection is left open at the end. the parser only reads it the same way together
+        // with what follows
+        bool irregular() const { return mIrregular; }
+
+        // the line at pos can start an entry, wait is set if that depends on bytes past size
+        static bool starts_entry(const char *data, size_t size, size_t pos, bool final, bool &wait);
+
+    private:
+        // the line at pos starts an entry of the root the first entry line started: "- " items of a sequence, keys
+        // of a map. a root that starts with neither is a scalar and has no entries
+        bool entry_line(const char *data, size_t size, size_t pos, bool final, bool &wait);
+        static bool key_line(const char *data, size_t size, size_t pos, bool final, bool &wait);
+
+        void finish();
+
+        // "---" or "..." at pos
+        static bool document_marker(const char *data, size_t size, size_t pos, bool final, bool &wait);
+
+        char mQuote = 0;
+        bool mEscape = false;
+        bool mComment = false;
+        bool mBlockScalar = false;
+        bool mSpace = false;
+        bool mLineStart = true;
+        bool mStarted = false;
+        bool mContent = false;
+        bool mEnded = false;
+        bool mIrregular = false;
+        size_t mMarkers = 0;
+        char mRoot = 0;
+        bool mAnchors = false;
+        char mPrev = '\n';
+        char mToken = 0;
+        char mLastToken = 0;
+        size_t mFlow = 0;
+
+        // column of the next byte, of the key or sequence item the current line is in, and of the one a block
+        // scalar belongs to. the scalar ends at the first line that isn't indented past it
+        size_t mColumn = 0;
+        size_t mNodeColumn = 0;
+        size_t mBlockColumn = 0;
+
+        // a plain scalar is open at the end of the line, lines indented past mPlainColumn continue it
+        bool mPlain = false;
+        size_t mPlainColumn = 0;
+    };
+
+    // target of indirect nodes. holds a value shared by every node that points here, built by materialize()
+    // on the first resolve. resolving is thread-safe, the value is immutable once built
+    class yaml::shared_node
+    {
+    public:
+        shared_node() : mRefs(1), mReady(false) {}
+        explicit shared_node(yaml &&value) : mRefs(1), mValue(std::move(value)), mReady(true) {}
+        virtual ~shared_node() {}
+
+        void retain() { mRefs.fetch_add(1, std::memory_order_relaxed); }
+        void release()
+        {
+            if (mRefs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                delete this;
+        }
+
+        bool unique() const { return mRefs.load(std::memory_order_acquire) == 1; }
+        size_t refs() const { return mRefs.load(std::memory_order_acquire); }
+
+        const yaml &get()
+        {
+            if (!mReady.load(std::memory_order_acquire))
+            {
+                std::call_once(mOnce, [this] {
+                    materialize(mValue);
+                    mReady.store(true, std::memory_order_release);
+                });
+            }
+
+            return mValue;
+        }
+
+        // only valid on a unique node, lets detach() steal the value instead of copying it
+        yaml &&take()
+        {
+            get();
+            return std::move(mValue);
+        }
+
+        // built already, reading it doesn't materialize anything
+        bool ready() const { return mReady.load(std::memory_order_acquire); }
+
+        // only valid on a unique, ready node, for changes that keep the value equal like compact()
+        yaml &value() { return mValue; }
+
+        virtual const table *as_table() const { return nullptr; }
+
+        // bytes held besides the value, for memory_usage()
+        virtual size_t allocated() const { return 0; }
+
+        StringViewT anchor() const { return mAnchor; }
+        void set_anchor(StringViewT name) { mAnchor = name; }
+
+        // shared to save memory only, written out at every reference instead of as an alias
+        bool inlined() const { return mInlined; }
+        void set_inlined() { mInlined = true; }
+
+    protected:
+        virtual void materialize(yaml &) {}
+
+    private:
+        std::atomic<size_t> mRefs;
+        yaml mValue;
+        std::atomic<bool> mReady;
+        std::once_flag mOnce;
+        StringT mAnchor;
+        bool mInlined = false;
+    };
+
+    // one row of a columnar table, built as a map on its first access
+    class yaml::table_row : public yaml::shared_node
+    {
+    public:
+        table_row(const std::shared_ptr<const table> &columns, size_t idx) : mColumns(columns), mIdx(idx) {}
+
+    protected:
+        void materialize(yaml &out) override { out = mColumns->row(mIdx); }
+
+    private:
+        std::shared_ptr<const table> mColumns;
+        size_t mIdx;
+    };
+
+    // type() and size() are answered by the table. the first read of the sequence only builds a table_row per
+    // row, and each row builds its map when it is read
+    class yaml::table_node : public yaml::shared_node
+    {
+    public:
+        table_node(table &&columns) : mTable(std::make_shared<const table>(std::move(columns))) {}
+
+        const table *as_table() const override { return mTable.get(); }
+        size_t allocated() const override { return sizeof(table) + mTable->allocated(); }
+
+    protected:
+        void materialize(yaml &out) override
+        {
+            out = yaml{value_t::sequence};
+            out.mSequence.reserve(mTable->rows());
+            for (size_t i = 0; i != mTable->rows(); i++)
+                out.mSequence.emplace_back().construct_indirect(new table_row{mTable, i});
+        }
+
+    private:
+        std::shared_ptr<const table> mTable;
+    };
+
+} // namespace ulib
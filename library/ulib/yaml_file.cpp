@@ -0,0 +1,113 @@
+#include "yaml_detail.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ulib
+{
+    namespace yaml_detail
+    {
+#ifdef _WIN32
+        bool mapped_file::open(ulib::string_view path)
+        {
+            close();
+
+            std::string spath{path.data(), path.size()};
+            HANDLE file = CreateFileA(spath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+                                      OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+            if (file == INVALID_HANDLE_VALUE)
+                return false;
+
+            LARGE_INTEGER size;
+            if (!GetFileSizeEx(file, &size))
+            {
+                CloseHandle(file);
+                return false;
+            }
+
+            mHandle = file;
+            mSize = size_t(size.QuadPart);
+            if (mSize == 0)
+                return true;
+
+            HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (!mapping)
+                return close(), false;
+
+            mMapping = mapping;
+            mData = (const uint8_t *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            if (!mData)
+                return close(), false;
+
+            return true;
+        }
+
+        void mapped_file::close()
+        {
+            if (mData)
+                UnmapViewOfFile(mData);
+            if (mMapping)
+                CloseHandle(mMapping);
+            if (mHandle)
+                CloseHandle(mHandle);
+
+            mData = nullptr;
+            mSize = 0;
+            mHandle = nullptr;
+            mMapping = nullptr;
+        }
+#else
+        bool mapped_file::open(ulib::string_view path)
+        {
+            close();
+
+            std::string spath{path.data(), path.size()};
+            int fd = ::open(spath.c_str(), O_RDONLY);
+            if (fd == -1)
+                return false;
+
+            struct stat st;
+            if (fstat(fd, &st) != 0)
+            {
+                ::close(fd);
+                return false;
+            }
+
+            mSize = size_t(st.st_size);
+            if (mSize != 0)
+            {
+                void *data = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (data == MAP_FAILED)
+                {
+                    ::close(fd);
+                    mSize = 0;
+                    return false;
+                }
+
+                mData = (const uint8_t *)data;
+            }
+
+            // the mapping keeps its own reference to the file
+            ::close(fd);
+            return true;
+        }
+
+        void mapped_file::close()
+        {
+            if (mData)
+                munmap((void *)mData, mSize);
+
+            mData = nullptr;
+            mSize = 0;
+        }
+#endif
+    } // namespace yaml_detail
+} // namespace ulib
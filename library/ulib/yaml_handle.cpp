@@ -0,0 +1,257 @@
+#include "yaml.h"
+
+#include <atomic>
+
+namespace ulib
+{
+    using StringViewT = typename yaml::StringViewT;
+    using value_t = typename yaml::value_t;
+
+    namespace yaml_detail
+    {
+        // item ids are unique across pools, so two pools on one document agree on them. 0 is left out
+        uint32_t next_item_id()
+        {
+            static std::atomic<uint32_t> counter{0};
+
+            uint32_t id = ++counter;
+            return id != 0 ? id : ++counter;
+        }
+    } // namespace yaml_detail
+
+    yaml::handle_pool::handle_pool(yaml &root) : mRoot(root)
+    {
+        // slot 0 is the root, it is never released
+        mSlots.emplace_back();
+    }
+
+    yaml::node_handle yaml::handle_pool::child(node_handle parent, StringViewT key)
+    {
+        yaml *node = get(parent);
+        if (!node)
+            return node_handle{};
+
+        node->detach();
+        if (node->mType != value_t::map)
+            return node_handle{};
+
+        ItemT *item = node->find_item(key, KeyT::hash_of(key));
+        if (!item)
+            return node_handle{};
+
+        if (item->mItemId == 0)
+            item->mItemId = yaml_detail::next_item_id();
+
+        child_key name{parent.index, false, 0, item->key()};
+        auto it = mChildren.find(name);
+        if (it != mChildren.end())
+        {
+            const slot &held = mSlots[it->second];
+            if (!held.gone && held.id == item->mItemId)
+                return node_handle{it->second, held.generation};
+
+            // the item under this key was removed since, the new one gets a new handle
+            release(node_handle{it->second, held.generation});
+        }
+
+        node_handle handle = add(std::move(name));
+        slot &entry = mSlots[handle.index];
+        entry.id = item->mItemId;
+        entry.storage = node->mMap.data();
+        entry.pos = size_t(item - node->mMap.data());
+        return handle;
+    }
+
+    yaml::node_handle yaml::handle_pool::child(node_handle parent, size_t idx)
+    {
+        yaml *node = get(parent);
+        if (!node)
+            return node_handle{};
+
+        node->detach();
+        if (node->mType != value_t::sequence || idx >= node->mSequence.size())
+            return node_handle{};
+
+        child_key name{parent.index, true, idx, KeyT{}};
+        auto it = mChildren.find(name);
+        if (it != mChildren.end())
+            return node_handle{it->second, mSlots[it->second].generation};
+
+        return add(std::move(name));
+    }
+
+    yaml *yaml::handle_pool::get(node_handle handle)
+    {
+        return valid(handle) ? resolve(handle.index) : nullptr;
+    }
+
+    const yaml *yaml::handle_pool::get(node_handle handle) const
+    {
+        return valid(handle) ? resolve(handle.index) : nullptr;
+    }
+
+    yaml::node_handle yaml::handle_pool::parent(node_handle handle) const
+    {
+        if (!valid(handle) || handle.index == 0)
+            return node_handle{};
+
+        uint32_t parent = mSlots[handle.index].parent;
+        return node_handle{parent, mSlots[parent].generation};
+    }
+
+    bool yaml::handle_pool::valid(node_handle handle) const
+    {
+        return handle.index < mSlots.size() && handle.generation != 0 &&
+               mSlots[handle.index].generation == handle.generation;
+    }
+
+    void yaml::handle_pool::release(node_handle handle)
+    {
+        if (!valid(handle) || handle.index == 0)
+            return;
+
+        slot &entry = mSlots[handle.index];
+        mChildren.erase(child_key{entry.parent, entry.item, entry.index, entry.key});
+
+        // copies of the handle stop resolving, 0 is left out so a default handle never matches
+        if (++entry.generation == 0)
+            entry.generation = 1;
+
+        // children still resolve through this slot, it is reused after the last of them is released
+        entry.released = true;
+        if (entry.children == 0)
+            recycle(handle.index);
+    }
+
+    yaml::node_handle yaml::handle_pool::add(child_key &&name)
+    {
+        uint32_t index;
+        if (!mFree.empty())
+        {
+            index = mFree.back();
+            mFree.pop_back();
+        }
+        else
+        {
+            index = uint32_t(mSlots.size());
+            mSlots.emplace_back();
+        }
+
+        slot &entry = mSlots[index];
+        entry.parent = name.parent;
+        entry.children = 0;
+        entry.released = false;
+        entry.item = name.item;
+        entry.index = name.index;
+        entry.key = name.key;
+        entry.id = 0;
+        entry.gone = false;
+        entry.storage = nullptr;
+        entry.pos = 0;
+
+        mSlots[name.parent].children++;
+        mChildren.emplace(std::move(name), index);
+        return node_handle{index, entry.generation};
+    }
+
+    yaml *yaml::handle_pool::resolve(uint32_t index)
+    {
+        if (index == 0)
+            return &mRoot;
+
+        slot &entry = mSlots[index];
+        if (entry.gone)
+            return nullptr;
+
+        yaml *parent = resolve(entry.parent);
+        if (!parent)
+            return nullptr;
+
+        parent->detach();
+        if (entry.item)
+        {
+            if (parent->mType != value_t::sequence || entry.index >= parent->mSequence.size())
+                return nullptr;
+
+            return &parent->mSequence[entry.index];
+        }
+
+        if (parent->mType != value_t::map)
+            return nullptr;
+
+        // the item found last, unless the storage was reallocated or items moved
+        MapT &items = parent->mMap;
+        if (entry.storage == items.data() && entry.pos < items.size() && items[entry.pos].mItemId == entry.id)
+            return &items[entry.pos].value();
+
+        // an item under the same key but with another id was added after the one of the handle was removed
+        ItemT *item = parent->find_item(entry.key.str(), entry.key.hash());
+        if (!item || item->mItemId != entry.id)
+        {
+            entry.gone = true;
+            return nullptr;
+        }
+
+        entry.storage = items.data();
+        entry.pos = size_t(item - items.data());
+        return &item->value();
+    }
+
+    const yaml *yaml::handle_pool::resolve(uint32_t index) const
+    {
+        if (index == 0)
+            return &mRoot.resolved();
+
+        const slot &entry = mSlots[index];
+        if (entry.gone)
+            return nullptr;
+
+        const yaml *parent = resolve(entry.parent);
+        if (!parent)
+            return nullptr;
+
+        if (entry.item)
+        {
+            if (parent->mType != value_t::sequence || entry.index >= parent->mSequence.size())
+                return nullptr;
+
+            return &parent->mSequence[entry.index].resolved();
+        }
+
+        if (parent->mType != value_t::map)
+            return nullptr;
+
+        const MapT &items = parent->mMap;
+        if (entry.storage == items.data() && entry.pos < items.size() && items[entry.pos].mItemId == entry.id)
+            return &items[entry.pos].value().resolved();
+
+        const ItemT *item = parent->find_item(entry.key.str(), entry.key.hash());
+        if (!item || item->mItemId != entry.id)
+            return nullptr;
+
+        return &item->value().resolved();
+    }
+
+    void yaml::handle_pool::recycle(uint32_t index)
+    {
+        // a released parent whose last child goes is recycled with it
+        while (index != 0)
+        {
+            slot &entry = mSlots[index];
+            uint32_t parent = entry.parent;
+
+            entry.key = KeyT{};
+            entry.gone = false;
+            entry.storage = nullptr;
+            entry.released = false;
+            mFree.push_back(index);
+
+            slot &up = mSlots[parent];
+            up.children--;
+            if (!up.released || up.children != 0)
+                break;
+
+            index = parent;
+        }
+    }
+} // namespace ulib
@@ -0,0 +1,253 @@
+#include "yaml.h"
+#include "yaml_detail.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+
+namespace ulib
+{
+    using StringViewT = typename yaml::StringViewT;
+    using StringT = typename yaml::StringT;
+
+    namespace yaml_detail
+    {
+        bool expand_env(StringViewT str, StringT &out, StringT &missing)
+        {
+            const char *it = str.data();
+            const char *end = it + str.size();
+
+            out.clear();
+            while (it != end)
+            {
+                const char *dollar = (const char *)std::memchr(it, '$', size_t(end - it));
+                if (!dollar)
+                    break;
+
+                out += StringViewT{it, size_t(dollar - it)};
+                it = dollar;
+
+                if (end - it >= 3 && it[1] == '$' && it[2] == '{')
+                {
+                    out += StringViewT{"${", 2};
+                    it += 3;
+                    continue;
+                }
+
+                const char *close = end - it >= 2 && it[1] == '{'
+                                        ? (const char *)std::memchr(it + 2, '}', size_t(end - it - 2))
+                                        : nullptr;
+                if (!close)
+                {
+                    out.push_back('$');
+                    it++;
+                    continue;
+                }
+
+                StringViewT body{it + 2, size_t(close - it - 2)};
+                StringViewT name = body;
+                const char *fallback = nullptr;
+                for (const char *c = body.data(); c + 1 < body.data() + body.size(); c++)
+                {
+                    if (c[0] == ':' && c[1] == '-')
+                    {
+                        name = StringViewT{body.data(), size_t(c - body.data())};
+                        fallback = c + 2;
+                        break;
+                    }
+                }
+
+                if (const char *value = std::getenv(std::string{name.data(), name.size()}.c_str()))
+                    out += StringViewT{value, std::strlen(value)};
+                else if (fallback)
+                    out += StringViewT{fallback, size_t(close - fallback)};
+                else
+                {
+                    missing = name;
+                    return false;
+                }
+
+                it = close + 1;
+            }
+
+            out += StringViewT{it, size_t(end - it)};
+            return true;
+        }
+    } // namespace yaml_detail
+
+    namespace fs = std::filesystem;
+
+    void yaml::include_resolver::clear()
+    {
+        for (auto &entry : mFragments)
+            entry.second.node->release();
+
+        mFragments.clear();
+    }
+
+    std::string yaml::include_resolver::absolute_path(StringViewT path) const
+    {
+        fs::path file{std::string{path.data(), path.size()}};
+        if (file.is_relative() && !mStack.empty())
+            file = fs::path{mStack.back()}.parent_path() / file;
+
+        std::error_code ec;
+        fs::path absolute = fs::absolute(file, ec);
+        if (ec)
+            absolute = file;
+
+        return absolute.lexically_normal().generic_string();
+    }
+
+    namespace yaml_detail
+    {
+        // false if the file can't be read
+        bool file_stamp(const fs::path &file, uint64_t &size, int64_t &mtime)
+        {
+            std::error_code ec;
+            size = fs::file_size(file, ec);
+            if (ec)
+                return false;
+
+            mtime = int64_t(fs::last_write_time(file, ec).time_since_epoch().count());
+            return !ec;
+        }
+    } // namespace yaml_detail
+
+    // unchanged since it was parsed, and so is everything it includes. a file whose modification time changed is
+    // compared by content. every fragment is checked once per top-level parse
+    bool yaml::include_resolver::is_current(const std::string &key, fragment &entry)
+    {
+        if (entry.checked == mGeneration)
+            return entry.current;
+
+        entry.checked = mGeneration;
+        entry.current = false;
+
+        uint64_t size;
+        int64_t mtime;
+        if (!yaml_detail::file_stamp(fs::path{key}, size, mtime) || size != entry.size)
+            return false;
+
+        if (mtime != entry.mtime)
+        {
+            yaml_detail::mapped_file file;
+            if (!file.open(ulib::string_view{key.data(), key.size()}) || file.size() != entry.size ||
+                yaml_detail::fnv1a(file.data(), file.size()) != entry.hash)
+                return false;
+
+            entry.mtime = mtime;
+        }
+
+        for (auto &dep : entry.includes)
+        {
+            auto it = mFragments.find(dep.path);
+            if (it == mFragments.end() || it->second.version != dep.version || !is_current(it->first, it->second))
+                return false;
+        }
+
+        return entry.current = true;
+    }
+
+    yaml yaml::include_resolver::parse_in_scope(const std::string &key, StringViewT text,
+                                                const parse_options &options, ulib::List<dependency> &includes)
+    {
+        for (size_t i = 0; i != mStack.size(); i++)
+        {
+            if (mStack[i] != key)
+                continue;
+
+            std::string chain;
+            for (size_t j = i; j != mStack.size(); j++)
+                chain += mStack[j] + " -> ";
+            chain += key;
+
+            throw yaml::parse_error{ulib::string{"[yaml.parse_error] ulib::yaml::parse_file(): include cycle "} +
+                                    chain};
+        }
+
+        parse_options inner = options;
+        inner.lazy = false;
+
+        mStack.push_back(key);
+        mIncludes.emplace_back();
+
+        yaml value;
+        try
+        {
+            value = parse(text, inner);
+        }
+        catch (...)
+        {
+            mStack.pop_back();
+            mIncludes.pop_back();
+            throw;
+        }
+
+        includes = std::move(mIncludes.back());
+        mStack.pop_back();
+        mIncludes.pop_back();
+
+        return value;
+    }
+
+    yaml yaml::include_resolver::parse_root(StringViewT path, const parse_options &options)
+    {
+        if (mStack.empty())
+            mGeneration++;
+
+        yaml_detail::mapped_file file;
+        if (!file.open(path))
+            throw yaml::exception{ulib::string{"[yaml.exception] ulib::yaml::parse_file(\""} + path +
+                                  "\"): can't open file"};
+
+        ulib::List<dependency> includes;
+        return parse_in_scope(absolute_path(path), StringViewT{(const CharT *)file.data(), file.size()}, options,
+                              includes);
+    }
+
+    yaml::shared_node *yaml::include_resolver::load(StringViewT path, const parse_options &options)
+    {
+        if (mStack.empty())
+            mGeneration++;
+
+        std::string key = absolute_path(path);
+
+        auto record = [&](fragment &entry) {
+            if (!mIncludes.empty())
+                mIncludes.back().push_back(dependency{key, entry.version});
+
+            entry.node->retain();
+            return entry.node;
+        };
+
+        auto it = mFragments.find(key);
+        if (it != mFragments.end() && is_current(key, it->second))
+            return record(it->second);
+
+        uint64_t size;
+        int64_t mtime;
+        yaml_detail::mapped_file file;
+        if (!yaml_detail::file_stamp(fs::path{key}, size, mtime) ||
+            !file.open(ulib::string_view{key.data(), key.size()}))
+            throw yaml::exception{ulib::string{"[yaml.exception] ulib::yaml::parse_file(\""} + key +
+                                  "\"): can't open included file"};
+
+        ulib::List<dependency> includes;
+        yaml value = parse_in_scope(key, StringViewT{(const CharT *)file.data(), file.size()}, options, includes);
+
+        // the parse may have added fragments, the entry is looked up again
+        fragment &entry = mFragments[key];
+        if (entry.node)
+            entry.node->release();
+
+        // shared between the files including it, but dumped as if each had its own copy
+        auto *node = new shared_node{std::move(value)};
+        node->set_inlined();
+
+        entry = fragment{file.size(), mtime, yaml_detail::fnv1a(file.data(), file.size()), ++mParsed,
+                         std::move(includes), node, mGeneration, true};
+        return record(entry);
+    }
+} // namespace ulib
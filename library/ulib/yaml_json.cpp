@@ -0,0 +1,392 @@
+#include "yaml.h"
+#include "yaml_detail.h"
+
+#include <cstring>
+
+namespace ulib
+{
+    // single pass JSON reader building nodes directly. containers are tracked on an explicit stack, so deep
+    // documents don't exhaust the call stack
+    class yaml::json_reader
+    {
+    public:
+        json_reader(StringViewT text, const parse_options &options, key_pool &keys)
+            : mBegin(text.data()), mIt(text.data()), mEnd(text.data() + text.size()), mOptions(options), mKeys(keys)
+        {
+            // trailing zeros from fixed size buffers, as parse_yaml_json() accepts them
+            while (mEnd != mBegin && mEnd[-1] == 0)
+                mEnd--;
+
+            if (mEnd - mIt >= 3 && uint8_t(mIt[0]) == 0xEF && uint8_t(mIt[1]) == 0xBB && uint8_t(mIt[2]) == 0xBF)
+                mIt += 3;
+        }
+
+        yaml read()
+        {
+            yaml root;
+            yaml *dest = &root;
+
+            for (;;)
+            {
+                skip_space();
+                if (mIt == mEnd)
+                    fail("unexpected end of input");
+
+                switch (*mIt)
+                {
+                case '{':
+                    mIt++;
+                    *dest = yaml{value_t::map};
+                    set_style(*dest, style_t::flow);
+
+                    skip_space();
+                    if (mIt != mEnd && *mIt == '}')
+                    {
+                        mIt++;
+                        if (mOptions.sorted_maps)
+                            dest->sort_items();
+                        break;
+                    }
+
+                    mStack.push_back(dest);
+                    dest = &read_member(*dest);
+                    continue;
+
+                case '[':
+                    mIt++;
+                    *dest = yaml{value_t::sequence};
+                    set_style(*dest, style_t::flow);
+
+                    skip_space();
+                    if (mIt != mEnd && *mIt == ']')
+                    {
+                        mIt++;
+                        break;
+                    }
+
+                    mStack.push_back(dest);
+                    dest = &dest->mSequence.emplace_back();
+                    continue;
+
+                case '"':
+                    *dest = yaml{StringT{read_string()}};
+                    set_style(*dest, style_t::quoted);
+                    break;
+
+                case 't':
+                    read_literal("true");
+                    *dest = yaml{StringT{"true"}};
+                    break;
+
+                case 'f':
+                    read_literal("false");
+                    *dest = yaml{StringT{"false"}};
+                    break;
+
+                case 'n':
+                    read_literal("null");
+                    *dest = yaml{};
+                    break;
+
+                default:
+                    *dest = yaml{StringT{read_number()}};
+                    break;
+                }
+
+                // the value is complete, close finished containers until one continues
+                dest = nullptr;
+                while (!mStack.empty())
+                {
+                    yaml &top = *mStack.back();
+
+                    skip_space();
+                    if (mIt == mEnd)
+                        fail("unexpected end of input");
+
+                    char c = *mIt++;
+                    if (c == ',')
+                    {
+                        if (top.mType == value_t::map)
+                        {
+                            skip_space();
+                            dest = &read_member(top);
+                        }
+                        else
+                        {
+                            dest = &top.mSequence.emplace_back();
+                        }
+                        break;
+                    }
+
+                    if (top.mType == value_t::map ? c != '}' : c != ']')
+                        fail(top.mType == value_t::map ? "expected ',' or '}'" : "expected ',' or ']'", mIt - 1);
+
+                    mStack.pop_back();
+                    if (top.mType == value_t::map && mOptions.sorted_maps)
+                        top.sort_items();
+                    else if (top.mType == value_t::sequence && mOptions.columnar &&
+                        top.mSequence.size() >= mOptions.columnar_min_rows)
+                        if (auto columns = table::from(top))
+                            top = yaml{std::move(columns.value())};
+                }
+
+                if (!dest)
+                    break;
+            }
+
+            skip_space();
+            if (mIt != mEnd)
+                fail("unexpected characters after the document");
+
+            return root;
+        }
+
+    private:
+        [[noreturn]] void fail(const char *what) { fail(what, mIt); }
+
+        [[noreturn]] void fail(const char *what, const char *at)
+        {
+            throw yaml::parse_error{ulib::string{"[yaml.parse_error] ulib::yaml::parse_json(): "} + what +
+                                    " at offset " + std::to_string(at - mBegin)};
+        }
+
+        void set_style(yaml &node, style_t style)
+        {
+            if (mOptions.preserve_style)
+                node.mStyle = style;
+        }
+
+        void skip_space()
+        {
+            while (mIt != mEnd && (*mIt == ' ' || *mIt == '\n' || *mIt == '\r' || *mIt == '\t'))
+                mIt++;
+        }
+
+        // "key": and the slot for its value
+        yaml &read_member(yaml &map)
+        {
+            if (mIt == mEnd || *mIt != '"')
+                fail("expected a string key");
+
+            KeyT key = mKeys.intern(read_string());
+
+            skip_space();
+            if (mIt == mEnd || *mIt != ':')
+                fail("expected ':'");
+            mIt++;
+
+            return map.find_or_create(key);
+        }
+
+        void read_literal(const char *literal)
+        {
+            size_t size = std::strlen(literal);
+            if (size_t(mEnd - mIt) < size || std::memcmp(mIt, literal, size) != 0)
+                fail("invalid literal");
+
+            mIt += size;
+        }
+
+        StringViewT read_number()
+        {
+            const char *start = mIt;
+
+            auto digits = [&]() {
+                const char *from = mIt;
+                while (mIt != mEnd && *mIt >= '0' && *mIt <= '9')
+                    mIt++;
+                return mIt != from;
+            };
+
+            if (mIt != mEnd && *mIt == '-')
+                mIt++;
+
+            if (mIt != mEnd && *mIt == '0')
+                mIt++;
+            else if (!digits())
+                fail("invalid value", start);
+
+            if (mIt != mEnd && *mIt == '.')
+            {
+                mIt++;
+                if (!digits())
+                    fail("invalid number", start);
+            }
+
+            if (mIt != mEnd && (*mIt == 'e' || *mIt == 'E'))
+            {
+                mIt++;
+                if (mIt != mEnd && (*mIt == '+' || *mIt == '-'))
+                    mIt++;
+                if (!digits())
+                    fail("invalid number", start);
+            }
+
+            return StringViewT{start, size_t(mIt - start)};
+        }
+
+        // first '"', '\\' or control character at or after it, eight bytes at a time. with validate_utf8 the
+        // blocks also stop at non-ASCII bytes, which are checked as they are passed
+        const char *scan_string(const char *it)
+        {
+            constexpr uint64_t kOnes = 0x0101010101010101ull;
+            constexpr uint64_t kHigh = 0x8080808080808080ull;
+
+            uint64_t ascii = mOptions.validate_utf8 ? kHigh : 0;
+            unsigned limit = mOptions.validate_utf8 ? 0x80 : 0x100;
+
+            for (;;)
+            {
+                while (mEnd - it >= 8)
+                {
+                    uint64_t v;
+                    std::memcpy(&v, it, 8);
+
+                    uint64_t quote = v ^ (kOnes * '"');
+                    uint64_t slash = v ^ (kOnes * '\\');
+                    uint64_t hit = ((quote - kOnes) & ~quote) | ((slash - kOnes) & ~slash) | ((v - kOnes * 0x20) & ~v);
+                    if ((hit | (v & ascii)) & kHigh)
+                        break;
+
+                    it += 8;
+                }
+
+                while (it != mEnd && *it != '"' && *it != '\\' && uint8_t(*it) >= 0x20 && uint8_t(*it) < limit)
+                    it++;
+
+                if (it == mEnd || uint8_t(*it) < 0x80)
+                    return it;
+
+                int size = yaml_detail::utf8_sequence(it, mEnd);
+                if (size <= 0)
+                    fail("invalid UTF-8", it);
+
+                it += size;
+            }
+        }
+
+        // contents of the string at mIt, a view of the input when there are no escapes
+        StringViewT read_string()
+        {
+            const char *start = ++mIt;
+            const char *it = scan_string(start);
+
+            if (it != mEnd && *it == '"')
+            {
+                mIt = it + 1;
+                return StringViewT{start, size_t(it - start)};
+            }
+
+            mScratch.clear();
+            for (;;)
+            {
+                mScratch += StringViewT{start, size_t(it - start)};
+
+                if (it == mEnd)
+                    fail("unterminated string", it);
+
+                if (*it == '"')
+                {
+                    mIt = it + 1;
+                    return mScratch;
+                }
+
+                if (*it != '\\')
+                    fail("control character in string", it);
+
+                if (++it == mEnd)
+                    fail("unterminated string", it);
+
+                switch (*it++)
+                {
+                case '"': mScratch.push_back('"'); break;
+                case '\\': mScratch.push_back('\\'); break;
+                case '/': mScratch.push_back('/'); break;
+                case 'b': mScratch.push_back('\b'); break;
+                case 'f': mScratch.push_back('\f'); break;
+                case 'n': mScratch.push_back('\n'); break;
+                case 'r': mScratch.push_back('\r'); break;
+                case 't': mScratch.push_back('\t'); break;
+                case 'u': it = read_escape(it); break;
+                default: fail("invalid escape", it - 1);
+                }
+
+                start = it;
+                it = scan_string(it);
+            }
+        }
+
+        uint32_t read_hex4(const char *it)
+        {
+            if (mEnd - it < 4)
+                fail("invalid \\u escape", it);
+
+            uint32_t value = 0;
+            for (int i = 0; i != 4; i++)
+            {
+                char c = it[i];
+                uint32_t digit;
+                if (c >= '0' && c <= '9')
+                    digit = c - '0';
+                else if (c >= 'a' && c <= 'f')
+                    digit = c - 'a' + 10;
+                else if (c >= 'A' && c <= 'F')
+                    digit = c - 'A' + 10;
+                else
+                    fail("invalid \\u escape", it);
+
+                value = value << 4 | digit;
+            }
+
+            return value;
+        }
+
+        // \uXXXX, with surrogate pairs, appended as UTF-8
+        const char *read_escape(const char *it)
+        {
+            uint32_t cp = read_hex4(it);
+            it += 4;
+
+            if (cp >= 0xD800 && cp <= 0xDBFF)
+            {
+                if (mEnd - it < 2 || it[0] != '\\' || it[1] != 'u')
+                    fail("unpaired surrogate", it);
+
+                uint32_t low = read_hex4(it + 2);
+                if (low < 0xDC00 || low > 0xDFFF)
+                    fail("unpaired surrogate", it);
+
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                it += 6;
+            }
+            else if (cp >= 0xDC00 && cp <= 0xDFFF)
+            {
+                fail("unpaired surrogate", it);
+            }
+
+            yaml_detail::append_utf8(mScratch, cp);
+
+            return it;
+        }
+
+        const char *mBegin;
+        const char *mIt;
+        const char *mEnd;
+        const parse_options &mOptions;
+        key_pool &mKeys;
+
+        ulib::List<yaml *> mStack;
+        StringT mScratch;
+    };
+
+    yaml yaml::parse_json(StringViewT str)
+    {
+        return parse_json(str, parse_options{});
+    }
+
+    yaml yaml::parse_json(StringViewT str, const parse_options &options)
+    {
+        key_pool localKeys;
+        return json_reader{str, options, options.keys ? *options.keys : localKeys}.read();
+    }
+} // namespace ulib
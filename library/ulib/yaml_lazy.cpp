@@ -0,0 +1,238 @@
+#include "yaml.h"
+#include "yaml_detail.h"
+
+namespace ulib
+{
+    using StringViewT = typename yaml::StringViewT;
+    using StringT = typename yaml::StringT;
+
+    // top-level value parsed from its entry text on first access. the entry is "key: value" or "- value",
+    // parsed as a document of its own
+    class yaml::lazy_node : public yaml::shared_node
+    {
+    public:
+        lazy_node(const std::shared_ptr<const void> &owner, StringViewT text, bool item, const parse_options &options)
+            : mOwner(owner), mText(text), mItem(item), mOptions(options)
+        {
+        }
+
+        // the entry text while it is unparsed, the source is freed with the last of them
+        size_t allocated() const override { return mOwner ? mText.size() * sizeof(CharT) : 0; }
+
+    protected:
+        void materialize(yaml &out) override
+        {
+            yaml entry = parse_yaml_json(mText, mOptions);
+
+            if (mItem && entry.mType == value_t::sequence && entry.mSequence.size() == 1)
+                out = std::move(entry.mSequence[0]);
+            else if (!mItem && entry.mType == value_t::map && entry.mMap.size() == 1)
+                out = std::move(entry.mMap[0].value());
+            else
+                throw yaml::parse_error{"[yaml.parse_error] ulib::yaml::parse(): lazy entry doesn't hold one " +
+                                        std::string{mItem ? "sequence item" : "map item"}};
+
+            // the source stays mapped until the last entry is parsed
+            mOwner.reset();
+        }
+
+    private:
+        std::shared_ptr<const void> mOwner;
+        StringViewT mText;
+        bool mItem;
+        parse_options mOptions;
+    };
+
+    namespace yaml_detail
+    {
+        inline bool is_blank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+        // comments, directives, blank lines and "---" before the first entry
+        bool only_preamble(const char *it, const char *end)
+        {
+            while (it != end)
+            {
+                const char *line = it;
+                while (it != end && *it != '\n')
+                    it++;
+
+                const char *lineEnd = it;
+                if (it != end)
+                    it++;
+
+                while (line != lineEnd && is_blank(*line))
+                    line++;
+
+                if (line == lineEnd || *line == '#' || *line == '%')
+                    continue;
+
+                if (lineEnd - line >= 3 && line[0] == '-' && line[1] == '-' && line[2] == '-')
+                {
+                    line += 3;
+                    while (line != lineEnd && is_blank(*line))
+                        line++;
+
+                    if (line == lineEnd || *line == '#')
+                        continue;
+                }
+
+                return false;
+            }
+
+            return true;
+        }
+
+        inline bool ends_key(const char *it, const char *end)
+        {
+            return *it == ':' && (it + 1 == end || is_blank(it[1]) || it[1] == '\n');
+        }
+    } // namespace yaml_detail
+
+    // key of a "key: value" entry, false for the forms only the full parser handles
+    static bool entry_key(const char *begin, const char *end, StringT &key)
+    {
+        char first = *begin;
+        if (first == '"' || first == '\'')
+        {
+            const char *it = begin + 1;
+            while (it != end)
+            {
+                if (first == '"' && *it == '\\' && it + 1 != end)
+                    it += 2;
+                else if (first == '\'' && *it == '\'' && it + 1 != end && it[1] == '\'')
+                    it += 2;
+                else if (*it == first)
+                    break;
+                else
+                    it++;
+            }
+
+            if (it == end)
+                return false;
+
+            const char *close = ++it;
+            while (it != end && yaml_detail::is_blank(*it))
+                it++;
+
+            if (it == end || !yaml_detail::ends_key(it, end))
+                return false;
+
+            return yaml_detail::decode_quoted(begin, close, key);
+        }
+
+        switch (first)
+        {
+        case '?': case '&': case '*': case '!': case '|': case '>': case '%': case '@': case '`':
+        case '[': case ']': case '{': case '}': case ',': case '#':
+            return false;
+        default:
+            break;
+        }
+
+        const char *it = begin;
+        while (it != end && *it != '\n' && !yaml_detail::ends_key(it, end))
+        {
+            if (*it == '#' && it != begin && yaml_detail::is_blank(it[-1]))
+                return false;
+            it++;
+        }
+
+        if (it == end || *it != ':')
+            return false;
+
+        while (it != begin && yaml_detail::is_blank(it[-1]))
+            it--;
+
+        StringViewT name{begin, size_t(it - begin)};
+        if (name.size() == 0 || name == "~" || name == "null" || name == "Null" || name == "NULL")
+            return false;
+
+        key = name;
+        return true;
+    }
+
+    yaml yaml::parse_lazy(const std::shared_ptr<const void> &owner, StringViewT text, const parse_options &options)
+    {
+        parse_options eagerOptions = options;
+        eagerOptions.lazy = false;
+
+        const char *data = text.data();
+        size_t size = text.size();
+        while (size != 0 && data[size - 1] == 0)
+            size--;
+
+        // checked once for every entry
+        if (options.validate_utf8)
+        {
+            yaml_detail::require_utf8(StringViewT{data, size}, "parse");
+            eagerOptions.validate_utf8 = false;
+        }
+
+        auto eager = [&]() { return parse(StringViewT{data, size}, eagerOptions); };
+
+        // structural skip: only line starts of top-level entries are recorded, up to the end of the first document
+        ulib::List<size_t> starts;
+        entry_scanner scanner;
+        size_t pos = 0;
+        while (scanner.next(data, size, pos, true))
+        {
+            if (scanner.ended())
+            {
+                size = pos;
+                break;
+            }
+
+            starts.push_back(pos);
+        }
+
+        // aliases need their anchors in the same parse
+        if (scanner.anchors() || scanner.irregular() || starts.empty() ||
+            !yaml_detail::only_preamble(data, data + starts[0]))
+            return eager();
+
+        auto is_item = [&](size_t at) {
+            return data[at] == '-' && (at + 1 == size || yaml_detail::is_blank(data[at + 1]) || data[at + 1] == '\n');
+        };
+
+        bool items = is_item(starts[0]);
+        for (size_t at : starts)
+            if (is_item(at) != items)
+                return eager();
+
+        key_pool localKeys;
+        key_pool &keys = options.keys ? *options.keys : localKeys;
+
+        yaml root{items ? value_t::sequence : value_t::map};
+        StringT key;
+
+        for (size_t i = 0; i != starts.size(); i++)
+        {
+            size_t from = starts[i];
+            size_t to = i + 1 != starts.size() ? starts[i + 1] : size;
+            StringViewT entry{data + from, to - from};
+
+            if (items)
+            {
+                root.mSequence.emplace_back().construct_indirect(new lazy_node{owner, entry, true, eagerOptions});
+                continue;
+            }
+
+            if (!entry_key(data + from, data + to, key))
+                return eager();
+
+            // a repeated key would drop the earlier entry unparsed, with any error in it
+            KeyT name = keys.intern(key);
+            if (root.find_item(name.str(), name.hash()))
+                return eager();
+
+            yaml &slot = root.find_or_create(name);
+            slot.construct_indirect(new lazy_node{owner, entry, false, eagerOptions});
+        }
+
+        // the entries sort their own maps when they are parsed
+        if (!items && options.sorted_maps)
+            root.sort_items();
+
+        return root;
+    }
+} // namespace ulib
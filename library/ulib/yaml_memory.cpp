@@ -0,0 +1,160 @@
+#include "yaml.h"
+#include "yaml_detail.h"
+
+#include <unordered_map>
+#include <unordered_set>
+
+namespace ulib
+{
+    using value_t = typename yaml::value_t;
+
+    namespace yaml_detail
+    {
+        // characters stored outside the string object, a short string kept inline has none
+        template <class StringT>
+        inline bool heap_string(const StringT &str)
+        {
+            auto data = (const char *)str.data();
+            auto self = (const char *)&str;
+            return !(data >= self && data < self + sizeof(str));
+        }
+    } // namespace yaml_detail
+
+    yaml::memory_stats yaml::memory_usage() const
+    {
+        memory_stats stats;
+        stats.nodes = sizeof(yaml);
+
+        std::unordered_set<const void *> seen;
+        ulib::List<const yaml *> stack;
+        stack.push_back(this);
+
+        while (!stack.empty())
+        {
+            const yaml *node = stack.back();
+            stack.pop_back();
+
+            if (node->mIndirect)
+            {
+                // the holder once, its value when it is built. the holder contains the value's node object
+                shared_node *shared = node->mNode;
+                if (!seen.insert(shared).second)
+                    continue;
+
+                stats.nodes += sizeof(shared_node);
+                stats.retained += shared->allocated();
+                if (const table *columns = shared->as_table())
+                    for (auto &key : columns->keys())
+                        if (seen.insert(key.buffer()).second)
+                            stats.keys += key.allocated();
+
+                if (shared->ready())
+                    stack.push_back(&shared->get());
+                continue;
+            }
+
+            stats.node_count++;
+            switch (node->mType)
+            {
+            case value_t::scalar:
+                if (yaml_detail::heap_string(node->mScalar))
+                {
+                    stats.scalars += node->mScalar.size();
+                    stats.slack += node->mScalar.capacity() - node->mScalar.size();
+                }
+                break;
+
+            case value_t::map:
+                stats.nodes += node->mMap.size() * sizeof(ItemT);
+                stats.slack += (node->mMap.capacity() - node->mMap.size()) * sizeof(ItemT);
+                for (auto &item : node->mMap)
+                {
+                    if (seen.insert(item.key().buffer()).second)
+                        stats.keys += item.key().allocated();
+                    stack.push_back(&item.value());
+                }
+                break;
+
+            case value_t::sequence:
+                stats.nodes += node->mSequence.size() * sizeof(yaml);
+                stats.slack += (node->mSequence.capacity() - node->mSequence.size()) * sizeof(yaml);
+                for (auto &value : node->mSequence)
+                    stack.push_back(&value);
+                break;
+
+            default:
+                break;
+            }
+        }
+
+        return stats;
+    }
+
+    void yaml::compact()
+    {
+        key_pool keys;
+        compact(keys);
+    }
+
+    void yaml::compact(key_pool &keys)
+    {
+        // a shared subtree that is also referenced from outside this tree may be read concurrently and stays as
+        // it is. the first walk counts the references from inside, the second one changes the tree
+        std::unordered_map<shared_node *, size_t> inside;
+        ulib::List<yaml *> stack;
+
+        auto walk = [&](bool change) {
+            std::unordered_set<shared_node *> entered;
+            stack.push_back(this);
+
+            while (!stack.empty())
+            {
+                yaml *node = stack.back();
+                stack.pop_back();
+
+                if (node->mIndirect)
+                {
+                    shared_node *shared = node->mNode;
+                    bool first = change ? entered.insert(shared).second : ++inside[shared] == 1;
+                    if (first && shared->ready() && (!change || inside[shared] == shared->refs()))
+                        stack.push_back(&shared->value());
+                    continue;
+                }
+
+                switch (node->mType)
+                {
+                case value_t::scalar:
+                    if (change)
+                        node->mScalar.shrink_to_fit();
+                    break;
+
+                case value_t::map:
+                    if (change)
+                        node->mMap.shrink_to_fit();
+
+                    for (auto &item : node->mMap)
+                    {
+                        if (change && item.key().buffer())
+                            item.mName = keys.intern(item.key().str());
+                        stack.push_back(&item.value());
+                    }
+                    break;
+
+                case value_t::sequence:
+                    if (change)
+                        node->mSequence.shrink_to_fit();
+
+                    for (auto &value : node->mSequence)
+                        stack.push_back(&value);
+                    break;
+
+                default:
+                    break;
+                }
+            }
+        };
+
+        walk(false);
+        walk(true);
+    }
+} // namespace ulib
@@ -1,68 +1,540 @@
 #include "yaml.h"
+#include "yaml_detail.h"
 
+#include <yaml-cpp/eventhandler.h>
 #include <yaml-cpp/yaml.h>
 
+#include <optional>
+#include <sstream>
+
 namespace ulib
 {
-    namespace yaml_detail
+    // builds the tree straight from parser events. anchored nodes become shared nodes and aliases
+    // point to them, so a subtree referenced many times is stored once
+    class yaml::event_builder : public YAML::EventHandler
     {
-        void convert_scalar(yaml &dest, const YAML::Node &node) { dest = yaml{node.Scalar()}; }
+    public:
+        event_builder(yaml &root, const parse_options &options, key_pool &keys)
+            : mRoot(root), mOptions(options), mKeys(keys), mAliasExpansion(0), mNodes(0)
+        {
+        }
 
-        void convert_node(yaml &dest, const YAML::Node &node);
-        void convert_map(yaml &dest, const YAML::Node &node)
+        ~event_builder() override
         {
-            for (auto it = node.begin(); it != node.end(); it++)
+            for (auto &anchor : mAnchors)
+                anchor.second.node->release();
+        }
+
+        void OnDocumentStart(const YAML::Mark &) override {}
+        void OnDocumentEnd() override {}
+
+        void OnAnchor(const YAML::Mark &, const std::string &anchor_name) override { mAnchorName = anchor_name; }
+
+        void OnNull(const YAML::Mark &, YAML::anchor_t anchor) override
+        {
+            if (mRows.active)
+            {
+                if (mRows.in_row && mRows.has_key && !anchor)
+                {
+                    row_cell(StringViewT{}, true);
+                    return;
+                }
+
+                leave_rows();
+            }
+
+            // a null key is the text "null", as in the yaml-cpp node conversion
+            if (at_key())
             {
-                auto &field = dest[it->first.as<std::string>()];
-                convert_node(field, it->second);
+                set_key(StringViewT{"null", 4});
+                if (anchor)
+                    add_anchor(anchor, new shared_node{yaml{}}, 1);
+                return;
             }
+
+            size_t start = mNodes++;
+            yaml &dest = slot();
+            dest = yaml{};
+            finish_node(dest, anchor, start);
         }
 
-        void convert_sequence(yaml &dest, const YAML::Node &node)
+        void OnAlias(const YAML::Mark &mark, YAML::anchor_t anchor) override
         {
-            for (auto it = node.begin(); it != node.end(); it++)
+            if (mRows.active)
+                leave_rows();
+
+            auto it = mAnchors.find(anchor);
+            if (it == mAnchors.end())
+                fail(mark, "unknown anchor");
+
+            shared_node *node = it->second.node;
+            if (at_key())
             {
-                convert_node(dest.push_back(), *it);
+                const yaml &key = node->get();
+                if (!key.is_scalar())
+                    fail(mark, "map keys must be scalars");
+
+                set_key(key.scalar());
+                return;
             }
+
+            // the subtree counts once per reference towards the expansion limit, even though it is stored once
+            mNodes += it->second.size;
+            mAliasExpansion += it->second.size;
+            if (mOptions.max_alias_expansion && mAliasExpansion > mOptions.max_alias_expansion)
+                fail(mark, "alias expansion limit exceeded");
+
+            yaml &dest = slot();
+            dest = yaml{};
+            node->retain();
+            dest.construct_indirect(node);
         }
 
-        void convert_node(yaml &dest, const YAML::Node &node)
+        void OnScalar(const YAML::Mark &mark, const std::string &tag, YAML::anchor_t anchor,
+                      const std::string &value) override
         {
-            switch (node.Type())
+            if (mRows.active)
             {
-            case YAML::NodeType::Map:
-                convert_map(dest, node);
-                return;
-            case YAML::NodeType::Sequence:
-                convert_sequence(dest, node);
-                return;
-            case YAML::NodeType::Scalar:
-                yaml_detail::convert_scalar(dest, node);
+                if (mRows.in_row && !anchor && !(mOptions.includes && tag == "!include"))
+                {
+                    if (mRows.has_key)
+                    {
+                        row_cell(expand(mark, value), false);
+                        return;
+                    }
+
+                    if (row_key(value))
+                        return;
+                }
+
+                leave_rows();
+            }
+
+            if (at_key())
+            {
+                set_key(value);
+                if (anchor)
+                    add_anchor(anchor, new shared_node{yaml{value}}, 1);
                 return;
-            case YAML::NodeType::Null:
+            }
+
+            size_t start = mNodes++;
+            yaml &dest = slot();
+
+            StringViewT text = expand(mark, value);
+
+            if (mOptions.includes && tag == "!include")
+            {
+                // the fragment is shared with every other include of the same file
                 dest = yaml{};
+                dest.construct_indirect(mOptions.includes->load(text, mOptions));
+                finish_node(dest, anchor, start);
                 return;
-            case YAML::NodeType::Undefined:
-                dest = yaml{};
+            }
+
+            dest = yaml{text};
+
+            // untagged scalars get the non-specific tag "!" when quoted or written as a block scalar
+            if (mOptions.preserve_style && tag == "!")
+                dest.mStyle = style_t::quoted;
+
+            finish_node(dest, anchor, start);
+        }
+
+        void OnSequenceStart(const YAML::Mark &mark, const std::string &, YAML::anchor_t anchor,
+                             YAML::EmitterStyle::value style) override
+        {
+            if (mRows.active)
+                leave_rows();
+
+            start_collection(mark, anchor, value_t::sequence, style);
+
+            // rows turned back into maps couldn't get their recorded styles back, those sequences are built as
+            // maps and converted at the end
+            if (mOptions.columnar && !mOptions.preserve_style)
+                begin_rows();
+        }
+
+        void OnSequenceEnd() override
+        {
+            if (mRows.active)
+            {
+                if (mRows.rows != 0 && mRows.rows >= mOptions.columnar_min_rows)
+                {
+                    mRows.active = false;
+                    mRows.columns->freeze();
+                    *mStack.back().node = yaml{std::move(*mRows.columns)};
+                }
+                else
+                {
+                    leave_rows();
+                }
+            }
+
+            frame top = std::move(mStack.back());
+            mStack.pop_back();
+
+            yaml &dest = *top.node;
+            if (mOptions.columnar && mOptions.preserve_style && dest.mSequence.size() >= mOptions.columnar_min_rows)
+                if (auto columns = table::from(dest))
+                    dest = yaml{std::move(columns.value())};
+
+            finish_node(dest, top.anchor, top.start);
+        }
+
+        void OnMapStart(const YAML::Mark &mark, const std::string &, YAML::anchor_t anchor,
+                        YAML::EmitterStyle::value style) override
+        {
+            if (mRows.active)
+            {
+                if (!mRows.in_row && !anchor)
+                {
+                    begin_row();
+                    return;
+                }
+
+                leave_rows();
+            }
+
+            start_collection(mark, anchor, value_t::map, style);
+        }
+
+        void OnMapEnd() override
+        {
+            if (mRows.active)
+            {
+                if (end_row())
+                    return;
+
+                leave_rows();
+            }
+
+            frame top = std::move(mStack.back());
+            mStack.pop_back();
+
+            if (mOptions.sorted_maps)
+                top.node->sort_items();
+
+            finish_node(*top.node, top.anchor, top.start);
+        }
+
+    private:
+        struct frame
+        {
+            yaml *node;
+            YAML::anchor_t anchor;
+            size_t start;
+            bool has_key;
+            KeyT key;
+        };
+
+        struct anchor_entry
+        {
+            shared_node *node;
+            size_t size;
+        };
+
+        // the sequence on top of the stack while its items are flat maps with the keys of the first one. cells
+        // go straight into columns, anything else turns the rows read so far back into maps
+        struct columnar_rows
+        {
+            bool active = false;
+            bool in_row = false;
+            bool has_key = false;
+            size_t rows = 0;
+            size_t pos = 0;
+            size_t start = 0;
+
+            // keys of the first row in source order, and the column each of them is stored in
+            ulib::List<KeyT> keys;
+            ulib::List<size_t> order;
+
+            // the first row is read as a map, the columns are made when it ends
+            yaml first;
+            std::optional<table> columns;
+        };
+
+        [[noreturn]] static void fail(const YAML::Mark &mark, const char *what)
+        {
+            throw yaml::parse_error{ulib::string{"[yaml.parse_error] ulib::yaml::parse(): "} + what + " at line " +
+                                    std::to_string(mark.line + 1) + ", column " + std::to_string(mark.column + 1)};
+        }
+
+        bool at_key() const
+        {
+            if (mStack.empty())
+                return false;
+
+            auto &top = mStack.back();
+            return top.node->mType == value_t::map && !top.has_key;
+        }
+
+        void set_key(StringViewT name)
+        {
+            auto &top = mStack.back();
+            top.key = mKeys.intern(name);
+            top.has_key = true;
+        }
+
+        // the node the next value event fills. parents are the last element of their own parent and don't grow
+        // until the child is finished, so pointers on the stack stay valid
+        yaml &slot()
+        {
+            if (mStack.empty())
+                return mRoot;
+
+            auto &top = mStack.back();
+            if (top.node->mType == value_t::sequence)
+                return top.node->mSequence.emplace_back();
+
+            top.has_key = false;
+            return top.node->find_or_create(top.key);
+        }
+
+        StringViewT expand(const YAML::Mark &mark, const std::string &value)
+        {
+            if (!mOptions.expand_env)
+                return StringViewT{value.data(), value.size()};
+
+            StringT missing;
+            if (!yaml_detail::expand_env(value, mExpanded, missing))
+                fail(mark, (ulib::string{"environment variable "} + missing + " is not set").c_str());
+
+            return mExpanded;
+        }
+
+        void begin_rows()
+        {
+            mRows.active = true;
+            mRows.in_row = false;
+            mRows.rows = 0;
+            mRows.keys.clear();
+            mRows.order.clear();
+            mRows.columns.reset();
+        }
+
+        void begin_row()
+        {
+            mRows.start = mNodes++;
+            mRows.in_row = true;
+            mRows.has_key = false;
+            mRows.pos = 0;
+
+            if (!mRows.columns)
+                mRows.first = yaml{value_t::map};
+        }
+
+        static bool same_key(const KeyT &left, const KeyT &right)
+        {
+            return left.same(right) || left.equals(right.str(), right.hash());
+        }
+
+        bool row_key(StringViewT name)
+        {
+            KeyT key = mKeys.intern(name);
+            if (!mRows.columns)
+            {
+                for (auto &seen : mRows.keys)
+                    if (same_key(key, seen))
+                        return false;
+
+                mRows.keys.push_back(key);
+            }
+            else if (mRows.pos == mRows.keys.size() || !same_key(key, mRows.keys[mRows.pos]))
+            {
+                return false;
+            }
+
+            mRows.has_key = true;
+            return true;
+        }
+
+        void row_cell(StringViewT text, bool null)
+        {
+            mNodes++;
+            if (!mRows.columns)
+            {
+                auto &value = mRows.first.mMap.emplace_back(mRows.keys[mRows.pos]).value();
+                if (!null)
+                    value.construct_as_string(text);
+            }
+            else
+            {
+                auto &col = mRows.columns->at(mRows.order[mRows.pos]);
+                if (null)
+                    col.push_null();
+                else
+                    col.push_back(text);
+            }
+
+            mRows.pos++;
+            mRows.has_key = false;
+        }
+
+        // false when the row doesn't fit the columns
+        bool end_row()
+        {
+            if (!mRows.columns)
+            {
+                if (mRows.pos == 0)
+                    return false;
+
+                if (mOptions.sorted_maps)
+                    mRows.first.sort_items();
+
+                ulib::List<KeyT> sorted;
+                for (auto &itm : mRows.first.mMap)
+                    sorted.push_back(itm.key());
+
+                for (auto &key : mRows.keys)
+                    for (size_t i = 0; i != sorted.size(); i++)
+                        if (key.same(sorted[i]))
+                            mRows.order.push_back(i);
+
+                mRows.columns.emplace(sorted);
+                for (size_t i = 0; i != sorted.size(); i++)
+                {
+                    auto &value = mRows.first.mMap[i].value();
+                    if (value.mType == value_t::null)
+                        mRows.columns->at(i).push_null();
+                    else
+                        mRows.columns->at(i).push_back(value.mScalar);
+                }
+
+                // already in order, marks the rows as sorted maps
+                if (mOptions.sorted_maps)
+                    mRows.columns->sort_keys();
+
+                mRows.first = yaml{};
+            }
+            else if (mRows.pos != mRows.keys.size())
+            {
+                return false;
+            }
+
+            mRows.rows++;
+            mRows.in_row = false;
+            return true;
+        }
+
+        // builds the rows read so far as maps. a row that is still open goes back on the stack with its cells
+        void leave_rows()
+        {
+            mRows.active = false;
+
+            yaml &dest = *mStack.back().node;
+            dest.mSequence.reserve(mRows.rows + 1);
+            for (size_t i = 0; i != mRows.rows; i++)
+            {
+                yaml &row = dest.mSequence.emplace_back(mRows.columns->row(i));
+                if (mOptions.sorted_maps)
+                    row.sort_items();
+            }
+
+            if (!mRows.in_row)
+                return;
+
+            yaml *row;
+            if (!mRows.columns)
+            {
+                row = &dest.mSequence.emplace_back(std::move(mRows.first));
+            }
+            else
+            {
+                row = &dest.mSequence.emplace_back(value_t::map);
+                for (size_t i = 0; i != mRows.pos; i++)
+                {
+                    auto &col = mRows.columns->at(mRows.order[i]);
+                    auto &value = row->mMap.emplace_back(mRows.keys[i]).value();
+                    if (!col.is_null(mRows.rows))
+                        value.construct_as_string(col.scalar(mRows.rows));
+                }
+            }
+
+            mStack.push_back(
+                frame{row, 0, mRows.start, mRows.has_key, mRows.has_key ? mRows.keys[mRows.pos] : KeyT{}});
+        }
+
+        void start_collection(const YAML::Mark &mark, YAML::anchor_t anchor, value_t type,
+                              YAML::EmitterStyle::value style)
+        {
+            if (at_key())
+                fail(mark, "map keys must be scalars");
+
+            size_t start = mNodes++;
+            yaml &dest = slot();
+            dest = yaml{type};
+            if (mOptions.preserve_style)
+                dest.mStyle = style == YAML::EmitterStyle::Flow ? style_t::flow : style_t::block;
+            mStack.push_back(frame{&dest, anchor, start, false, KeyT{}});
+        }
+
+        void finish_node(yaml &dest, YAML::anchor_t anchor, size_t start)
+        {
+            if (!anchor)
                 return;
-            default:
-                throw ulib::yaml::internal_error{
-                    "[yaml.internal_error] yaml_detail::convert_node(): invalid YAML NodeType" +
-                    std::to_string((int)node.Type())};
+
+            shared_node *node;
+            if (dest.mIndirect)
+            {
+                node = dest.mNode;
+                node->retain();
+            }
+            else
+            {
+                node = new shared_node{std::move(dest)};
+                node->retain();
+                dest.construct_indirect(node);
+            }
+
+            add_anchor(anchor, node, mNodes - start);
+        }
+
+        void add_anchor(YAML::anchor_t anchor, shared_node *node, size_t size)
+        {
+            if (!mAnchorName.empty())
+            {
+                node->set_anchor(mAnchorName);
+                mAnchorName.clear();
+            }
+
+            auto result = mAnchors.emplace(anchor, anchor_entry{node, size});
+            if (!result.second)
+            {
+                result.first->second.node->release();
+                result.first->second = anchor_entry{node, size};
             }
         }
-    } // namespace detail
 
-    yaml parse_yaml_json(string_view str)
+        yaml &mRoot;
+        const parse_options &mOptions;
+        key_pool &mKeys;
+
+        ulib::List<frame> mStack;
+        columnar_rows mRows;
+        std::unordered_map<YAML::anchor_t, anchor_entry> mAnchors;
+        std::string mAnchorName;
+        StringT mExpanded;
+        size_t mAliasExpansion;
+        size_t mNodes;
+    };
+
+    yaml yaml::parse_yaml_json(StringViewT str, const parse_options &options)
     {
         auto data = ulib::str(str);
         while (data.ends_with(0)) // it can be more than 0
             data.pop_back();
         // data.MarkZeroEnd();
 
-        YAML::Node node = YAML::Load(data);
+        std::istringstream stream{std::string{data.data(), data.size()}};
+        YAML::Parser parser{stream};
+
+        key_pool localKeys;
         yaml value;
-        yaml_detail::convert_node(value, node);
+
+        event_builder builder{value, options, options.keys ? *options.keys : localKeys};
+        parser.HandleNextDocument(builder);
+
         return value;
     }
 } // namespace ulib
@@ -77,7 +549,82 @@ namespace ulib
 
     yaml yaml::parse(StringViewT str)
     {
-        return parse_yaml_json(str);
+        return parse(str, parse_options{});
+    }
+
+    yaml yaml::parse(StringViewT str, key_pool &keys)
+    {
+        parse_options options;
+        options.keys = &keys;
+        return parse(str, options);
+    }
+
+    yaml yaml::parse(StringViewT str, const parse_options &options)
+    {
+        // UTF-16 and UTF-32 input is read from one UTF-8 copy, a UTF-8 byte order mark is skipped
+        size_t bom;
+        std::string transcoded;
+        auto encoding = yaml_detail::detect_encoding(str.data(), str.size(), bom);
+        if (encoding != yaml_detail::input_encoding::utf8)
+        {
+            size_t error;
+            if (!yaml_detail::transcode_to_utf8(encoding, str.data() + bom, str.size() - bom, transcoded, error))
+                throw parse_error{ulib::string{"[yaml.parse_error] ulib::yaml::parse(): invalid "} +
+                                  yaml_detail::encoding_name(encoding) + " at byte " + std::to_string(bom + error)};
+
+            str = StringViewT{transcoded.data(), transcoded.size()};
+        }
+        else if (bom != 0)
+        {
+            str = StringViewT{str.data() + bom, str.size() - bom};
+        }
+
+        if (options.lazy && !options.includes)
+        {
+            // entries point into the text, they keep their own copy alive
+            auto copy = std::make_shared<std::string>(str.data(), str.size());
+            return parse_lazy(copy, StringViewT{copy->data(), copy->size()}, options);
+        }
+
+        // the JSON reader doesn't expand variables
+        if (!options.expand_env && yaml_detail::starts_like_json(str))
+        {
+            // flow style YAML starts the same way, it only costs a second pass when the JSON reader rejects it.
+            // the reader checks UTF-8 in strings itself
+            try
+            {
+                return parse_json(str, options);
+            }
+            catch (const parse_error &)
+            {
+            }
+        }
+
+        if (options.validate_utf8)
+            yaml_detail::require_utf8(str, "parse");
+
+        return parse_yaml_json(str, options);
+    }
+
+    yaml yaml::parse_file(StringViewT path)
+    {
+        return parse_file(path, parse_options{});
+    }
+
+    yaml yaml::parse_file(StringViewT path, const parse_options &options)
+    {
+        // relative includes start at this file
+        if (options.includes)
+            return options.includes->parse_root(path, options);
+
+        yaml_detail::mapped_file file;
+        if (!file.open(path))
+            throw yaml::exception{ulib::string{"[yaml.exception] ulib::yaml::parse_file(\""} + path +
+                                  "\"): can't open file"};
+
+        // lazy entries get a copy from parse(). the mapping would show later changes to the file to values
+        // parsed later, and a truncated file would fault on their first access
+        return parse(StringViewT{(const CharT *)file.data(), file.size()}, options);
     }
 
 
@@ -0,0 +1,872 @@
+#include "yaml.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <exception>
+#include <thread>
+
+namespace ulib
+{
+    using StringViewT = typename yaml::StringViewT;
+    using value_t = typename yaml::value_t;
+
+    namespace
+    {
+        // inputs per thread below which a step isn't split
+        constexpr size_t kParallelShare = 2048;
+
+        bool parse_number(StringViewT str, double &out)
+        {
+            const char *it = str.data();
+            const char *end = it + str.size();
+            if (it != end && *it == '+')
+                it++;
+            if (it == end)
+                return false;
+
+            auto result = std::from_chars(it, end, out);
+            return result.ec == std::errc{} && result.ptr == end;
+        }
+
+        bool null_scalar(StringViewT str) { return str == "null" || str == "Null" || str == "NULL" || str == "~"; }
+
+        int compare_bytes(StringViewT left, StringViewT right)
+        {
+            int result = std::memcmp(left.data(), right.data(), std::min(left.size(), right.size()));
+            if (result != 0)
+                return result < 0 ? -1 : 1;
+
+            return left.size() < right.size() ? -1 : left.size() > right.size() ? 1 : 0;
+        }
+
+        int compare_numbers(double left, double right) { return left < right ? -1 : left > right ? 1 : 0; }
+
+        // splits size inputs into contiguous shares, body(begin, end, out) fills one output per share and the
+        // outputs are appended in order, so the result is the one a single thread gets
+        template <class BodyT>
+        void parallel(size_t size, size_t threads, ulib::List<const yaml *> &out, BodyT body)
+        {
+            size_t count = std::min(threads, size / kParallelShare);
+            if (count < 2)
+            {
+                body(size_t(0), size, out);
+                return;
+            }
+
+            ulib::List<ulib::List<const yaml *>> parts;
+            ulib::List<std::exception_ptr> errors;
+            parts.resize(count);
+            errors.resize(count);
+            ulib::List<std::thread> workers;
+
+            auto share = [&](size_t i) {
+                try
+                {
+                    body(size * i / count, size * (i + 1) / count, parts[i]);
+                }
+                catch (...)
+                {
+                    errors[i] = std::current_exception();
+                }
+            };
+
+            for (size_t i = 1; i != count; i++)
+                workers.emplace_back(share, i);
+            share(0);
+
+            for (auto &worker : workers)
+                worker.join();
+
+            for (auto &error : errors)
+                if (error)
+                    std::rethrow_exception(error);
+
+            for (auto &part : parts)
+                for (const yaml *node : part)
+                    out.push_back(node);
+        }
+    } // namespace
+
+    // operand of a comparison: a node found by a path, a literal or nothing
+    struct yaml::query::value
+    {
+        enum class kind_t
+        {
+            none,
+            node,
+            number,
+            string,
+            boolean,
+            null,
+        };
+
+        kind_t kind = kind_t::none;
+        const yaml *node = nullptr;
+        double number = 0;
+        StringViewT text;
+        bool boolean = false;
+    };
+
+    class yaml::query::parser
+    {
+    public:
+        parser(query &q, StringViewT text) : q(q), mText(text), mPos(0) {}
+
+        void parse()
+        {
+            skip_spaces();
+
+            // $, a leading dot or a bare name start the query at the root
+            ulib::List<step> steps;
+            if (peek() == '$')
+                mPos++;
+            else if (peek() == '.' && (mPos + 1 == mText.size() || name_char(mText[mPos + 1])))
+            {
+                mPos++;
+                if (mPos != mText.size())
+                    steps.push_back(name_step(name()));
+            }
+            else if (name_char(peek()))
+                steps.push_back(name_step(name()));
+
+            segments(steps);
+            skip_spaces();
+            if (mPos != mText.size())
+                fail("unexpected character");
+
+            q.mFirst = q.mSteps.size();
+            q.mLength = steps.size();
+            for (auto &s : steps)
+                q.mSteps.push_back(std::move(s));
+        }
+
+    private:
+        [[noreturn]] void fail(const char *what)
+        {
+            throw yaml::parse_error{ulib::string{"[yaml.parse_error] ulib::yaml::query(): "} + what + " at position " +
+                                    std::to_string(mPos) + " in \"" + mText + "\""};
+        }
+
+        char peek() const { return mPos != mText.size() ? mText[mPos] : '\0'; }
+        bool next_is(const char *token) const
+        {
+            size_t size = std::strlen(token);
+            return mText.size() - mPos >= size && std::memcmp(mText.data() + mPos, token, size) == 0;
+        }
+
+        void expect(char c)
+        {
+            skip_spaces();
+            if (peek() != c)
+                fail(c == ']' ? "expected ']'" : c == ')' ? "expected ')'" : "unexpected character");
+            mPos++;
+        }
+
+        void skip_spaces()
+        {
+            while (peek() == ' ' || peek() == '\t')
+                mPos++;
+        }
+
+        static bool name_char(char c)
+        {
+            return c != '\0' && !std::strchr(".[]()*?@$=!<>&|,'\" \t:", c);
+        }
+
+        StringViewT name()
+        {
+            size_t start = mPos;
+            while (name_char(peek()))
+                mPos++;
+            if (start == mPos)
+                fail("expected a name");
+
+            return StringViewT{mText.data() + start, mPos - start};
+        }
+
+        static step name_step(StringViewT key)
+        {
+            step s{step_t::name};
+            s.name = key;
+            s.hash = KeyT::hash_of(key);
+            return s;
+        }
+
+        void segments(ulib::List<step> &steps)
+        {
+            for (;;)
+            {
+                if (next_is(".."))
+                {
+                    mPos += 2;
+                    steps.push_back(step{step_t::descend});
+                    if (peek() == '*')
+                        mPos++, steps.push_back(step{step_t::children});
+                    else if (peek() == '[')
+                        bracket(steps);
+                    else
+                        steps.push_back(name_step(name()));
+                }
+                else if (peek() == '.')
+                {
+                    mPos++;
+                    if (peek() == '*')
+                        mPos++, steps.push_back(step{step_t::children});
+                    else if (peek() == '[')
+                        bracket(steps);
+                    else
+                        steps.push_back(name_step(name()));
+                }
+                else if (peek() == '[')
+                    bracket(steps);
+                else
+                    return;
+            }
+        }
+
+        void bracket(ulib::List<step> &steps)
+        {
+            mPos++;
+            skip_spaces();
+
+            if (peek() == '*')
+            {
+                mPos++;
+                expect(']');
+                steps.push_back(step{step_t::children});
+                return;
+            }
+
+            if (peek() == '?')
+            {
+                mPos++;
+                step s{step_t::filter};
+                s.expr = any();
+                expect(']');
+                steps.push_back(std::move(s));
+                return;
+            }
+
+            ulib::List<step> selectors;
+            for (;;)
+            {
+                skip_spaces();
+                if (peek() == '\'' || peek() == '"')
+                    selectors.push_back(name_step(quoted()));
+                else
+                    selectors.push_back(index_or_slice());
+
+                skip_spaces();
+                if (peek() != ',')
+                    break;
+                mPos++;
+            }
+            expect(']');
+
+            if (selectors.size() == 1)
+            {
+                steps.push_back(std::move(selectors[0]));
+                return;
+            }
+
+            // selectors have no nested steps, they go to the query right away
+            step group{step_t::group};
+            group.first = q.mSteps.size();
+            group.count = selectors.size();
+            for (auto &s : selectors)
+                q.mSteps.push_back(std::move(s));
+            steps.push_back(std::move(group));
+        }
+
+        bool integer(int64_t &out)
+        {
+            skip_spaces();
+            size_t start = mPos;
+            if (peek() == '-')
+                mPos++;
+            while (peek() >= '0' && peek() <= '9')
+                mPos++;
+            if (mPos == start)
+                return false;
+
+            auto result = std::from_chars(mText.data() + start, mText.data() + mPos, out);
+            if (result.ec != std::errc{} || result.ptr != mText.data() + mPos)
+                fail("expected an integer");
+
+            return true;
+        }
+
+        step index_or_slice()
+        {
+            step s{step_t::index};
+            s.has_start = integer(s.start);
+            skip_spaces();
+            if (peek() != ':')
+            {
+                if (!s.has_start)
+                    fail("expected a name, an index or a slice");
+                return s;
+            }
+
+            mPos++;
+            s.kind = step_t::slice;
+            s.has_end = integer(s.end);
+            skip_spaces();
+            if (peek() == ':')
+            {
+                mPos++;
+                if (!integer(s.stride))
+                    s.stride = 1;
+            }
+
+            return s;
+        }
+
+        StringViewT quoted()
+        {
+            char quote = mText[mPos++];
+            size_t start = mPos;
+            while (mPos != mText.size() && mText[mPos] != quote)
+                mPos++;
+            if (mPos == mText.size())
+                fail("unterminated string");
+
+            return StringViewT{mText.data() + start, mPos++ - start};
+        }
+
+        size_t add(expr_t kind, size_t left, size_t right = 0)
+        {
+            q.mExprs.push_back(expr{kind, left, right});
+            return q.mExprs.size() - 1;
+        }
+
+        size_t any()
+        {
+            size_t left = all();
+            for (skip_spaces(); next_is("||"); skip_spaces())
+            {
+                mPos += 2;
+                left = add(expr_t::any, left, all());
+            }
+
+            return left;
+        }
+
+        size_t all()
+        {
+            size_t left = unary();
+            for (skip_spaces(); next_is("&&"); skip_spaces())
+            {
+                mPos += 2;
+                left = add(expr_t::all, left, unary());
+            }
+
+            return left;
+        }
+
+        size_t unary()
+        {
+            skip_spaces();
+            if (peek() == '!' && !next_is("!="))
+            {
+                mPos++;
+                return add(expr_t::negate, unary());
+            }
+
+            if (peek() == '(')
+            {
+                mPos++;
+                size_t inner = any();
+                expect(')');
+                return inner;
+            }
+
+            return comparison();
+        }
+
+        size_t comparison()
+        {
+            static const std::pair<const char *, expr_t> ops[] = {
+                {"==", expr_t::equal},   {"!=", expr_t::not_equal}, {"<=", expr_t::less_equal},
+                {">=", expr_t::greater_equal}, {"<", expr_t::less},  {">", expr_t::greater},
+            };
+
+            size_t left = term();
+            skip_spaces();
+
+            for (auto &op : ops)
+            {
+                if (!next_is(op.first))
+                    continue;
+
+                mPos += std::strlen(op.first);
+                size_t right = term();
+
+                // a literal on the left is swapped to the right, so that filters over table columns find it
+                auto path = [&](size_t idx) {
+                    operand_t kind = q.mOperands[idx].kind;
+                    return kind == operand_t::current || kind == operand_t::root;
+                };
+
+                expr_t kind = op.second;
+                if (!path(left) && path(right))
+                {
+                    std::swap(left, right);
+                    if (kind == expr_t::less)
+                        kind = expr_t::greater;
+                    else if (kind == expr_t::greater)
+                        kind = expr_t::less;
+                    else if (kind == expr_t::less_equal)
+                        kind = expr_t::greater_equal;
+                    else if (kind == expr_t::greater_equal)
+                        kind = expr_t::less_equal;
+                }
+
+                return add(kind, left, right);
+            }
+
+            operand_t kind = q.mOperands[left].kind;
+            if (kind != operand_t::current && kind != operand_t::root)
+                fail("expected a comparison");
+
+            return add(expr_t::exists, left);
+        }
+
+        size_t term()
+        {
+            skip_spaces();
+
+            operand o{operand_t::current};
+            char c = peek();
+            if (c == '@' || c == '$')
+            {
+                mPos++;
+                o.kind = c == '@' ? operand_t::current : operand_t::root;
+
+                ulib::List<step> steps;
+                segments(steps);
+
+                o.first = q.mSteps.size();
+                o.count = steps.size();
+                for (auto &s : steps)
+                {
+                    if (s.kind != step_t::name && s.kind != step_t::index)
+                        o.singular = false;
+                    q.mSteps.push_back(std::move(s));
+                }
+            }
+            else if (c == '\'' || c == '"')
+            {
+                o.kind = operand_t::string;
+                o.text = quoted();
+            }
+            else if (c == '-' || c == '+' || c == '.' || (c >= '0' && c <= '9'))
+            {
+                size_t start = mPos;
+                while (peek() && std::strchr("+-.0123456789eE", peek()))
+                    mPos++;
+
+                o.kind = operand_t::number;
+                if (!parse_number(StringViewT{mText.data() + start, mPos - start}, o.number))
+                    fail("expected a number");
+            }
+            else if (next_is("true") || next_is("false") || next_is("null"))
+            {
+                o.kind = c == 'n' ? operand_t::null : operand_t::boolean;
+                o.boolean = c == 't';
+                mPos += c == 'f' ? 5 : 4;
+            }
+            else
+                fail("expected a path or a literal");
+
+            q.mOperands.push_back(std::move(o));
+            return q.mOperands.size() - 1;
+        }
+
+        query &q;
+        StringViewT mText;
+        size_t mPos;
+    };
+
+    yaml::query::query(StringViewT expression) : mExpression(expression)
+    {
+        parser{*this, mExpression}.parse();
+    }
+
+    ulib::List<const yaml *> yaml::query::select(const yaml &root, size_t threads) const
+    {
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+
+        ulib::List<const yaml *> nodes;
+        nodes.push_back(&root);
+        run(mFirst, mLength, root, nodes, threads);
+        return nodes;
+    }
+
+    const yaml *yaml::query::first(const yaml &root) const
+    {
+        ulib::List<const yaml *> nodes = select(root);
+        return nodes.empty() ? nullptr : nodes[0];
+    }
+
+    void yaml::query::run(size_t first, size_t count, const yaml &root, ulib::List<const yaml *> &nodes,
+                          size_t threads) const
+    {
+        // one step at a time over every input, which keeps the results in document order
+        for (size_t i = first; i != first + count && !nodes.empty(); i++)
+        {
+            const step &s = mSteps[i];
+
+            ulib::List<const yaml *> next;
+            if (s.kind == step_t::filter)
+                filter(s, nodes, root, next, threads);
+            else
+                parallel(nodes.size(), threads, next, [&](size_t begin, size_t end, ulib::List<const yaml *> &out) {
+                    for (size_t j = begin; j != end; j++)
+                        apply(s, *nodes[j], root, out);
+                });
+
+            nodes = std::move(next);
+        }
+    }
+
+    void yaml::query::apply(const step &s, const yaml &node, const yaml &root, ulib::List<const yaml *> &out) const
+    {
+        const yaml &self = node.resolved();
+        switch (s.kind)
+        {
+        case step_t::name:
+            if (self.mType == value_t::map)
+                if (const ItemT *item = self.find_item(s.name, s.hash))
+                    out.push_back(&item->value());
+            break;
+
+        case step_t::index:
+            if (self.mType == value_t::sequence)
+            {
+                int64_t size = int64_t(self.mSequence.size());
+                int64_t idx = s.start < 0 ? s.start + size : s.start;
+                if (idx >= 0 && idx < size)
+                    out.push_back(&self.mSequence[size_t(idx)]);
+            }
+            break;
+
+        case step_t::slice:
+            if (self.mType == value_t::sequence && s.stride != 0)
+            {
+                // python slice bounds
+                int64_t size = int64_t(self.mSequence.size());
+                auto bound = [&](bool has, int64_t v, int64_t fallback) {
+                    if (!has)
+                        return fallback;
+                    if (v < 0)
+                        v += size;
+                    return s.stride > 0 ? std::clamp<int64_t>(v, 0, size) : std::clamp<int64_t>(v, -1, size - 1);
+                };
+
+                if (s.stride > 0)
+                {
+                    for (int64_t i = bound(s.has_start, s.start, 0), end = bound(s.has_end, s.end, size); i < end;
+                         i += s.stride)
+                        out.push_back(&self.mSequence[size_t(i)]);
+                }
+                else
+                {
+                    for (int64_t i = bound(s.has_start, s.start, size - 1), end = bound(s.has_end, s.end, -1);
+                         i > end; i += s.stride)
+                        out.push_back(&self.mSequence[size_t(i)]);
+                }
+            }
+            break;
+
+        case step_t::children:
+            if (self.mType == value_t::map)
+                for (auto &item : self.mMap)
+                    out.push_back(&item.value());
+            else if (self.mType == value_t::sequence)
+                for (auto &value : self.mSequence)
+                    out.push_back(&value);
+            break;
+
+        case step_t::descend: {
+            // the node and everything below it in document order, without recursion
+            ulib::List<const yaml *> stack;
+            stack.push_back(&node);
+            while (!stack.empty())
+            {
+                const yaml *top = stack.back();
+                stack.pop_back();
+                out.push_back(top);
+
+                const yaml &current = top->resolved();
+                if (current.mType == value_t::map)
+                    for (size_t i = current.mMap.size(); i != 0; i--)
+                        stack.push_back(&current.mMap[i - 1].value());
+                else if (current.mType == value_t::sequence)
+                    for (size_t i = current.mSequence.size(); i != 0; i--)
+                        stack.push_back(&current.mSequence[i - 1]);
+            }
+            break;
+        }
+
+        case step_t::filter: {
+            ulib::List<const yaml *> one;
+            one.push_back(&node);
+            filter(s, one, root, out, 1);
+            break;
+        }
+
+        case step_t::group:
+            for (size_t i = 0; i != s.count; i++)
+                apply(mSteps[s.first + i], node, root, out);
+            break;
+        }
+    }
+
+    void yaml::query::filter(const step &s, const ulib::List<const yaml *> &nodes, const yaml &root,
+                             ulib::List<const yaml *> &out, size_t threads) const
+    {
+        // the children of all inputs are tested together, so that one long sequence is split between threads
+        // as well as many short ones
+        ulib::List<const yaml *> candidates;
+        auto flush = [&]() {
+            parallel(candidates.size(), threads, out, [&](size_t begin, size_t end, ulib::List<const yaml *> &part) {
+                for (size_t i = begin; i != end; i++)
+                    if (test(s.expr, *candidates[i], root))
+                        part.push_back(candidates[i]);
+            });
+            candidates.clear();
+        };
+
+        step children{step_t::children};
+        for (const yaml *node : nodes)
+        {
+            if (node->as_table())
+            {
+                flush();
+                if (scan_table(s, *node, out))
+                    continue;
+            }
+
+            apply(children, *node, root, candidates);
+        }
+
+        flush();
+    }
+
+    bool yaml::query::scan_table(const step &s, const yaml &node, ulib::List<const yaml *> &out) const
+    {
+        // @.key compared to a number over a typed column: a loop over the column instead of a lookup per row
+        const expr &e = mExprs[s.expr];
+        if (e.kind < expr_t::equal)
+            return false;
+
+        const operand &left = mOperands[e.left];
+        const operand &right = mOperands[e.right];
+        if (left.kind != operand_t::current || left.count != 1 || mSteps[left.first].kind != step_t::name ||
+            right.kind != operand_t::number)
+            return false;
+
+        const table *columns = node.as_table();
+        const table::column *column = columns->find(mSteps[left.first].name);
+        if (!column || column->type() == table::column_t::string)
+            return false;
+
+        // matches are found in the columns, only then the rows are looked at, as unbuilt table_row stubs
+        ulib::List<size_t> hits;
+        auto scan = [&](auto cells) {
+            double bound = right.number;
+            for (size_t i = 0; i != column->size(); i++)
+            {
+                // a null cell compares like a missing key
+                bool hit;
+                if (column->is_null(i))
+                    hit = e.kind == expr_t::not_equal;
+                else
+                {
+                    double v = double(cells[i]);
+                    switch (e.kind)
+                    {
+                    case expr_t::equal: hit = v == bound; break;
+                    case expr_t::not_equal: hit = v != bound; break;
+                    case expr_t::less: hit = v < bound; break;
+                    case expr_t::less_equal: hit = v <= bound; break;
+                    case expr_t::greater: hit = v > bound; break;
+                    default: hit = v >= bound; break;
+                    }
+                }
+
+                if (hit)
+                    hits.push_back(i);
+            }
+        };
+
+        if (column->type() == table::column_t::integer)
+            scan(column->integers().data());
+        else
+            scan(column->floats().data());
+
+        if (hits.empty())
+            return true;
+
+        span<const yaml> rows = node.values();
+        for (size_t i : hits)
+            out.push_back(&rows[i]);
+
+        return true;
+    }
+
+    bool yaml::query::test(size_t idx, const yaml &node, const yaml &root) const
+    {
+        const expr &e = mExprs[idx];
+        switch (e.kind)
+        {
+        case expr_t::any: return test(e.left, node, root) || test(e.right, node, root);
+        case expr_t::all: return test(e.left, node, root) && test(e.right, node, root);
+        case expr_t::negate: return !test(e.left, node, root);
+        case expr_t::exists: return evaluate(mOperands[e.left], node, root).kind != value::kind_t::none;
+        default: break;
+        }
+
+        using kind_t = value::kind_t;
+        value left = evaluate(mOperands[e.left], node, root);
+        value right = evaluate(mOperands[e.right], node, root);
+
+        // nodes take the form of the other side: a number, a string, a boolean or null
+        auto as = [](value &v, kind_t kind) {
+            if (v.kind != kind_t::node)
+                return;
+
+            const yaml &n = v.node->resolved();
+            if (n.mType == value_t::null)
+            {
+                v.kind = kind_t::null;
+                return;
+            }
+
+            if (n.mType != value_t::scalar)
+                return;
+
+            StringViewT str = n.mScalar;
+            if (kind == kind_t::number && parse_number(str, v.number))
+                v.kind = kind_t::number;
+            else if (kind == kind_t::string)
+                v.kind = kind_t::string, v.text = str;
+            else if (kind == kind_t::boolean)
+            {
+                if (std::optional<bool> b = n.try_get<bool>())
+                    v.kind = kind_t::boolean, v.boolean = *b;
+            }
+            else if (kind == kind_t::null && null_scalar(str))
+                v.kind = kind_t::null;
+        };
+
+        // -1, 0 or 1 if ordered, 0 or 2 (different) otherwise
+        int relation = 2;
+        bool ordered = false;
+        if (left.kind == kind_t::node && right.kind == kind_t::node)
+        {
+            const yaml &l = left.node->resolved();
+            const yaml &r = right.node->resolved();
+            double a, b;
+            if (l.mType == value_t::scalar && r.mType == value_t::scalar)
+            {
+                ordered = true;
+                if (parse_number(l.mScalar, a) && parse_number(r.mScalar, b))
+                    relation = compare_numbers(a, b);
+                else
+                    relation = compare_bytes(l.mScalar, r.mScalar);
+            }
+            else
+                relation = l.equal(r) ? 0 : 2;
+        }
+        else
+        {
+            as(left, right.kind);
+            as(right, left.kind);
+
+            if (left.kind == right.kind)
+            {
+                switch (left.kind)
+                {
+                case kind_t::number:
+                    ordered = true, relation = compare_numbers(left.number, right.number);
+                    break;
+                case kind_t::string:
+                    ordered = true, relation = compare_bytes(left.text, right.text);
+                    break;
+                case kind_t::boolean: relation = left.boolean == right.boolean ? 0 : 2; break;
+                default: relation = 0; break;
+                }
+            }
+        }
+
+        switch (e.kind)
+        {
+        case expr_t::equal: return relation == 0;
+        case expr_t::not_equal: return relation != 0;
+        case expr_t::less: return ordered && relation < 0;
+        case expr_t::less_equal: return ordered && relation <= 0;
+        case expr_t::greater: return ordered && relation > 0;
+        default: return ordered && relation >= 0;
+        }
+    }
+
+    yaml::query::value yaml::query::evaluate(const operand &o, const yaml &node, const yaml &root) const
+    {
+        value result;
+        switch (o.kind)
+        {
+        case operand_t::number: result.kind = value::kind_t::number, result.number = o.number; return result;
+        case operand_t::string: result.kind = value::kind_t::string, result.text = o.text; return result;
+        case operand_t::boolean: result.kind = value::kind_t::boolean, result.boolean = o.boolean; return result;
+        case operand_t::null: result.kind = value::kind_t::null; return result;
+        default: break;
+        }
+
+        const yaml *start = o.kind == operand_t::current ? &node : &root;
+        if (o.singular)
+        {
+            // names and indices lead to one node at most, found without collecting it in a list
+            const yaml *at = start;
+            for (size_t i = 0; i != o.count && at; i++)
+            {
+                const step &s = mSteps[o.first + i];
+                const yaml &self = at->resolved();
+                at = nullptr;
+
+                if (s.kind == step_t::name && self.mType == value_t::map)
+                {
+                    if (const ItemT *item = self.find_item(s.name, s.hash))
+                        at = &item->value();
+                }
+                else if (s.kind == step_t::index && self.mType == value_t::sequence)
+                {
+                    int64_t size = int64_t(self.mSequence.size());
+                    int64_t idx = s.start < 0 ? s.start + size : s.start;
+                    if (idx >= 0 && idx < size)
+                        at = &self.mSequence[size_t(idx)];
+                }
+            }
+
+            if (at)
+                result.kind = value::kind_t::node, result.node = at;
+            return result;
+        }
+
+        // a path that finds several nodes compares its first one
+        ulib::List<const yaml *> nodes;
+        nodes.push_back(start);
+        run(o.first, o.count, root, nodes, 1);
+        if (!nodes.empty())
+            result.kind = value::kind_t::node, result.node = nodes[0];
+        return result;
+    }
+
+    ulib::List<const yaml *> yaml::select(StringViewT expression, size_t threads) const
+    {
+        return query{expression}.select(*this, threads);
+    }
+} // namespace ulib
@@ -0,0 +1,586 @@
+#include "yaml_schema.h"
+#include "yaml_detail.h"
+
+#include <charconv>
+#include <cmath>
+
+namespace ulib
+{
+    namespace yaml_schema_detail
+    {
+        using StringViewT = typename yaml::StringViewT;
+        using value_t = typename yaml::value_t;
+
+        enum type_bits : uint32_t
+        {
+            type_null = 1,
+            type_string = 2,
+            type_integer = 4,
+            type_number = 8,
+            type_boolean = 16,
+            type_array = 32,
+            type_object = 64,
+        };
+
+        struct type_name
+        {
+            const char *name;
+            uint32_t bit;
+        };
+
+        constexpr type_name kTypeNames[] = {
+            {"null", type_null},       {"string", type_string}, {"integer", type_integer}, {"number", type_number},
+            {"boolean", type_boolean}, {"array", type_array},   {"object", type_object},
+        };
+
+        uint32_t type_bit(StringViewT name)
+        {
+            for (auto &t : kTypeNames)
+                if (name == StringViewT{t.name})
+                    return t.bit;
+
+            return 0;
+        }
+
+        ulib::string type_mask_to_string(uint32_t mask)
+        {
+            ulib::string result;
+            for (auto &t : kTypeNames)
+            {
+                if (!(mask & t.bit))
+                    continue;
+
+                if (!result.empty())
+                    result += " | ";
+                result += t.name;
+            }
+
+            return result;
+        }
+
+        // decimal with an optional exponent, as JSON writes numbers
+        bool is_number_text(StringViewT str, StringViewT *mantissa, int *exponent)
+        {
+            size_t e = 0;
+            while (e != str.size() && str.data()[e] != 'e' && str.data()[e] != 'E')
+                e++;
+
+            StringViewT m{str.data(), e};
+            if (!yaml_detail::is_decimal_text(m))
+                return false;
+
+            int exp = 0;
+            if (e != str.size())
+            {
+                auto it = str.data() + e + 1;
+                auto end = str.data() + str.size();
+
+                bool neg = it != end && *it == '-';
+                if (it != end && (*it == '-' || *it == '+'))
+                    it++;
+
+                if (it == end || end - it > 4)
+                    return false;
+
+                for (; it != end; it++)
+                {
+                    if (!(*it >= '0' && *it <= '9'))
+                        return false;
+                    exp = exp * 10 + (*it - '0');
+                }
+
+                if (neg)
+                    exp = -exp;
+            }
+
+            if (mantissa)
+                *mantissa = m;
+            if (exponent)
+                *exponent = exp;
+
+            return true;
+        }
+
+        bool number_of(const yaml &node, double &out)
+        {
+            if (!node.is_scalar())
+                return false;
+
+            StringViewT str = node.scalar();
+            int exponent = 0;
+            if (!is_number_text(str, nullptr, &exponent))
+                return false;
+
+            auto result = std::from_chars(str.data(), str.data() + str.size(), out);
+            if (result.ec == std::errc::result_out_of_range)
+                out = std::copysign(exponent > 0 ? HUGE_VAL : 0.0, str.data()[0] == '-' ? -1.0 : 1.0);
+
+            return true;
+        }
+
+        bool matches_type(const yaml &node, uint32_t mask)
+        {
+            switch (node.type())
+            {
+            case value_t::null:
+                return mask & type_null;
+            case value_t::sequence:
+                return mask & type_array;
+            case value_t::map:
+                return mask & type_object;
+            case value_t::scalar:
+                break;
+            }
+
+            if (mask & type_string)
+                return true;
+
+            StringViewT str = node.scalar();
+            if ((mask & type_integer) && yaml_detail::is_integer_text(str))
+                return true;
+            if ((mask & type_number) && is_number_text(str, nullptr, nullptr))
+                return true;
+            if ((mask & type_boolean) && node.try_get<bool>())
+                return true;
+
+            return false;
+        }
+
+        size_t count_code_points(StringViewT str)
+        {
+            size_t count = 0;
+            for (auto c : str)
+                count += (uint8_t(c) & 0xC0) != 0x80;
+            return count;
+        }
+
+        ulib::string number_to_string(double v)
+        {
+            if (v == std::floor(v) && std::fabs(v) < 1e15)
+                return std::to_string(int64_t(v));
+            return std::to_string(v);
+        }
+    } // namespace yaml_schema_detail
+
+    struct yaml_schema::path_frame
+    {
+        const path_frame *parent;
+        StringViewT key;
+        size_t index;
+        bool is_index;
+
+        ulib::string to_string() const
+        {
+            ulib::string result = parent ? parent->to_string() : ulib::string{"$"};
+            if (is_index)
+                result += ulib::string{"["} + std::to_string(index) + "]";
+            else
+                result += ulib::string{"."} + key;
+
+            return result;
+        }
+
+        static ulib::string to_string(const path_frame *frame) { return frame ? frame->to_string() : "$"; }
+    };
+
+    // sinks: fail() returns false to stop validation
+
+    struct yaml_schema::first_failure
+    {
+        template <class MessageT>
+        bool fail(const path_frame *, MessageT &&)
+        {
+            return false;
+        }
+    };
+
+    struct yaml_schema::collector
+    {
+        ulib::List<violation> &out;
+
+        template <class MessageT>
+        bool fail(const path_frame *path, MessageT &&message)
+        {
+            out.push_back(violation{path_frame::to_string(path), message()});
+            return true;
+        }
+    };
+
+    yaml_schema::yaml_schema()
+    {
+        mProgram.push_back(instruction{op_t::end, 0, 0, 0});
+        mRoot = 0;
+    }
+
+    yaml_schema::yaml_schema(const yaml &schema) { mRoot = compile_block(schema, "$"); }
+
+    bool yaml_schema::valid(const yaml &document) const
+    {
+        first_failure sink;
+        return run(mRoot, document, nullptr, sink);
+    }
+
+    ulib::List<yaml_schema::violation> yaml_schema::validate(const yaml &document) const
+    {
+        ulib::List<violation> result;
+        collector sink{result};
+        run(mRoot, document, nullptr, sink);
+        return result;
+    }
+
+    uint32_t yaml_schema::compile_block(const yaml &schema, StringViewT where)
+    {
+        using namespace yaml_schema_detail;
+
+        auto fail = [&](StringViewT what) {
+            throw schema_error{ulib::string{"[yaml.schema_error] ulib::yaml_schema(): "} + where + ": " + what};
+        };
+
+        auto number = [&](const yaml &value, StringViewT key) {
+            double v = 0;
+            if (!number_of(value, v))
+                fail(ulib::string{key} + " must be a number");
+            return v;
+        };
+
+        ulib::List<instruction> local;
+
+        if (schema.is_null())
+        {
+            mProgram.push_back(instruction{op_t::end, 0, 0, 0});
+            return uint32_t(mProgram.size() - 1);
+        }
+
+        if (!schema.is_map())
+            fail("schema must be a map");
+
+        object_rule rule{0, 0, 0, kAllowAdditional, -1, -1};
+        ulib::List<property> properties;
+        bool isObject = false;
+
+        auto find_property = [&](StringViewT name) -> property * {
+            for (auto &p : properties)
+                if (p.key.str() == name)
+                    return &p;
+            return nullptr;
+        };
+
+        for (auto &itm : schema.items())
+        {
+            StringViewT key = itm.name();
+            const yaml &value = itm.value();
+
+            if (key == "type")
+            {
+                uint32_t mask = 0;
+                if (value.is_scalar())
+                    mask = type_bit(value.scalar());
+                else if (value.is_sequence())
+                    for (auto &t : value.values())
+                        mask |= t.is_scalar() ? type_bit(t.scalar()) : 0;
+
+                if (!mask)
+                    fail("unknown type");
+
+                local.push_back(instruction{op_t::type, mask, 0, 0});
+            }
+            else if (key == "enum")
+            {
+                if (!value.is_sequence())
+                    fail("enum must be a sequence");
+
+                uint32_t first = uint32_t(mConstants.size());
+                for (auto &v : value.values())
+                    mConstants.push_back(v);
+
+                local.push_back(instruction{op_t::enum_of, first, uint32_t(value.size()), 0});
+            }
+            else if (key == "minItems")
+                local.push_back(instruction{op_t::min_items, 0, 0, number(value, key)});
+            else if (key == "maxItems")
+                local.push_back(instruction{op_t::max_items, 0, 0, number(value, key)});
+            else if (key == "minLength")
+                local.push_back(instruction{op_t::min_length, 0, 0, number(value, key)});
+            else if (key == "maxLength")
+                local.push_back(instruction{op_t::max_length, 0, 0, number(value, key)});
+            else if (key == "minimum")
+                local.push_back(instruction{op_t::minimum, 0, 0, number(value, key)});
+            else if (key == "maximum")
+                local.push_back(instruction{op_t::maximum, 0, 0, number(value, key)});
+            else if (key == "items")
+            {
+                uint32_t block = compile_block(value, ulib::string{where} + ".items");
+                local.push_back(instruction{op_t::items, block, 0, 0});
+            }
+            else if (key == "properties")
+            {
+                if (!value.is_map())
+                    fail("properties must be a map");
+
+                isObject = true;
+                for (auto &prop : value.items())
+                {
+                    uint32_t block = compile_block(prop.value(), ulib::string{where} + "." + prop.name());
+                    if (property *p = find_property(prop.name()))
+                        p->block = block;
+                    else
+                        properties.push_back(property{prop.key(), block, false});
+                }
+            }
+            else if (key == "required")
+            {
+                if (!value.is_sequence())
+                    fail("required must be a sequence");
+
+                isObject = true;
+                for (auto &name : value.values())
+                {
+                    if (!name.is_scalar())
+                        fail("required must contain property names");
+
+                    property *p = find_property(name.scalar());
+                    if (!p)
+                        p = &properties.emplace_back(property{KeyT{name.scalar()}, uint32_t(-1), false});
+
+                    p->required = true;
+                }
+            }
+            else if (key == "additionalProperties")
+            {
+                isObject = true;
+                if (value.is_map())
+                    rule.additional = compile_block(value, ulib::string{where} + ".additionalProperties");
+                else if (auto allow = value.try_get<bool>())
+                    rule.additional = allow.value() ? kAllowAdditional : kDenyAdditional;
+                else
+                    fail("additionalProperties must be a boolean or a schema");
+            }
+            else if (key == "minProperties")
+            {
+                isObject = true;
+                rule.min_properties = number(value, key);
+            }
+            else if (key == "maxProperties")
+            {
+                isObject = true;
+                rule.max_properties = number(value, key);
+            }
+
+            // other keywords (title, description, $schema, ...) don't constrain the document
+        }
+
+        if (isObject)
+        {
+            // required-only properties accept any value
+            for (auto &p : properties)
+                if (p.block == uint32_t(-1))
+                    p.block = compile_block(yaml{}, where);
+
+            rule.first_property = uint32_t(mProperties.size());
+            rule.property_count = uint32_t(properties.size());
+            for (auto &p : properties)
+            {
+                rule.required_count += p.required;
+                mProperties.push_back(p);
+            }
+
+            mObjects.push_back(rule);
+            local.push_back(instruction{op_t::object, uint32_t(mObjects.size() - 1), 0, 0});
+        }
+
+        uint32_t start = uint32_t(mProgram.size());
+        for (auto &ins : local)
+            mProgram.push_back(ins);
+        mProgram.push_back(instruction{op_t::end, 0, 0, 0});
+
+        return start;
+    }
+
+    template <class SinkT>
+    bool yaml_schema::run(uint32_t block, const yaml &node, const path_frame *path, SinkT &sink) const
+    {
+        using namespace yaml_schema_detail;
+
+        for (uint32_t pc = block;; pc++)
+        {
+            const instruction &ins = mProgram[pc];
+
+            switch (ins.op)
+            {
+            case op_t::end:
+                return true;
+
+            case op_t::type:
+                if (!matches_type(node, ins.a))
+                {
+                    // a node of the wrong type would only produce follow-up noise
+                    return sink.fail(path, [&] {
+                        return ulib::string{"expected "} + type_mask_to_string(ins.a) + ", got " +
+                               yaml::type_to_string(node.type());
+                    });
+                }
+                break;
+
+            case op_t::enum_of: {
+                bool found = false;
+                for (uint32_t i = 0; i != ins.b && !found; i++)
+                    found = mConstants[ins.a + i] == node;
+
+                if (!found && !sink.fail(path, [&] { return ulib::string{"value is not one of the enum values"}; }))
+                    return false;
+                break;
+            }
+
+            case op_t::min_items:
+            case op_t::max_items: {
+                if (!node.is_sequence())
+                    break;
+
+                double size = double(node.size());
+                bool isMin = ins.op == op_t::min_items;
+                if (isMin ? size < ins.number : size > ins.number)
+                {
+                    if (!sink.fail(path, [&] {
+                            return ulib::string{isMin ? "expected at least " : "expected at most "} +
+                                   number_to_string(ins.number) + " items, got " + std::to_string(node.size());
+                        }))
+                        return false;
+                }
+                break;
+            }
+
+            case op_t::min_length:
+            case op_t::max_length: {
+                if (!node.is_scalar())
+                    break;
+
+                double length = double(count_code_points(node.scalar()));
+                bool isMin = ins.op == op_t::min_length;
+                if (isMin ? length < ins.number : length > ins.number)
+                {
+                    if (!sink.fail(path, [&] {
+                            return ulib::string{isMin ? "expected at least " : "expected at most "} +
+                                   number_to_string(ins.number) + " characters";
+                        }))
+                        return false;
+                }
+                break;
+            }
+
+            case op_t::minimum:
+            case op_t::maximum: {
+                double v = 0;
+                if (!number_of(node, v))
+                    break;
+
+                bool isMin = ins.op == op_t::minimum;
+                if (isMin ? v < ins.number : v > ins.number)
+                {
+                    if (!sink.fail(path, [&] {
+                            return ulib::string{isMin ? "expected a value >= " : "expected a value <= "} +
+                                   number_to_string(ins.number) + ", got " + node.scalar();
+                        }))
+                        return false;
+                }
+                break;
+            }
+
+            case op_t::object:
+                if (node.is_map() && !run_object(mObjects[ins.a], node, path, sink))
+                    return false;
+                break;
+
+            case op_t::items:
+                if (node.is_sequence())
+                {
+                    auto values = node.values();
+                    for (size_t i = 0; i != values.size(); i++)
+                    {
+                        path_frame frame{path, StringViewT{}, i, true};
+                        if (!run(ins.a, values[i], &frame, sink))
+                            return false;
+                    }
+                }
+                break;
+            }
+        }
+    }
+
+    template <class SinkT>
+    bool yaml_schema::run_object(const object_rule &rule, const yaml &node, const path_frame *path,
+                                 SinkT &sink) const
+    {
+        using namespace yaml_schema_detail;
+
+        auto items = node.items();
+        double count = double(items.size());
+
+        if (rule.min_properties >= 0 && count < rule.min_properties)
+        {
+            if (!sink.fail(path, [&] {
+                    return ulib::string{"expected at least "} + number_to_string(rule.min_properties) +
+                           " properties";
+                }))
+                return false;
+        }
+
+        if (rule.max_properties >= 0 && count > rule.max_properties)
+        {
+            if (!sink.fail(path, [&] {
+                    return ulib::string{"expected at most "} + number_to_string(rule.max_properties) + " properties";
+                }))
+                return false;
+        }
+
+        const property *first = mProperties.data() + rule.first_property;
+        const property *last = first + rule.property_count;
+
+        uint32_t seenRequired = 0;
+        for (auto &itm : items)
+        {
+            const KeyT &key = itm.key();
+
+            // hashes are stored in both keys, so a miss costs one integer compare per property
+            const property *prop = first;
+            for (; prop != last; prop++)
+                if (prop->key.same(key) || prop->key.equals(key.str(), key.hash()))
+                    break;
+
+            path_frame frame{path, itm.name(), 0, false};
+
+            if (prop != last)
+            {
+                seenRequired += prop->required;
+                if (!run(prop->block, itm.value(), &frame, sink))
+                    return false;
+            }
+            else if (rule.additional == kDenyAdditional)
+            {
+                if (!sink.fail(&frame, [&] { return ulib::string{"additional property is not allowed"}; }))
+                    return false;
+            }
+            else if (rule.additional != kAllowAdditional)
+            {
+                if (!run(rule.additional, itm.value(), &frame, sink))
+                    return false;
+            }
+        }
+
+        if (seenRequired == rule.required_count)
+            return true;
+
+        for (const property *prop = first; prop != last; prop++)
+        {
+            if (!prop->required || node.search(prop->key.str()))
+                continue;
+
+            if (!sink.fail(path, [&] {
+                    return ulib::string{"missing required property \""} + prop->key.str() + "\"";
+                }))
+                return false;
+        }
+
+        return true;
+    }
+
+} // namespace ulib
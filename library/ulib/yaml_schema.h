@@ -0,0 +1,105 @@
+#pragma once
+
+#include "yaml.h"
+
+namespace ulib
+{
+    // validator for a JSON-Schema subset: type, enum, properties, required, additionalProperties, items,
+    // minItems/maxItems, minProperties/maxProperties, minLength/maxLength and minimum/maximum.
+    // the schema is compiled once into a flat program; validation is a single pass over the document
+    // that only allocates to report violations
+    class yaml_schema
+    {
+    public:
+        class schema_error : public yaml::exception
+        {
+        public:
+            using exception::exception;
+        };
+
+        struct violation
+        {
+            ulib::string path;
+            ulib::string message;
+        };
+
+        using StringT = typename yaml::StringT;
+        using StringViewT = typename yaml::StringViewT;
+        using KeyT = typename yaml::KeyT;
+
+        // accepts every document
+        yaml_schema();
+        explicit yaml_schema(const yaml &schema);
+
+        static yaml_schema parse(StringViewT schema) { return yaml_schema{yaml::parse(schema)}; }
+
+        // stops at the first violation
+        bool valid(const yaml &document) const;
+
+        // every violation, with paths like $.hosts[2].name
+        ulib::List<violation> validate(const yaml &document) const;
+
+    private:
+        enum class op_t : uint8_t
+        {
+            end,
+            type,        // a: type mask
+            enum_of,     // a: first constant, b: constant count
+            min_items,   // number
+            max_items,   // number
+            min_length,  // number
+            max_length,  // number
+            minimum,     // number
+            maximum,     // number
+            object,      // a: object rule
+            items,       // a: block
+        };
+
+        struct instruction
+        {
+            op_t op;
+            uint32_t a;
+            uint32_t b;
+            double number;
+        };
+
+        struct property
+        {
+            KeyT key;
+            uint32_t block;
+            bool required;
+        };
+
+        static constexpr uint32_t kAllowAdditional = uint32_t(-1);
+        static constexpr uint32_t kDenyAdditional = uint32_t(-2);
+
+        struct object_rule
+        {
+            uint32_t first_property;
+            uint32_t property_count;
+            uint32_t required_count;
+            uint32_t additional; // block, kAllowAdditional or kDenyAdditional
+            double min_properties;
+            double max_properties;
+        };
+
+        struct path_frame;
+        struct first_failure;
+        struct collector;
+
+        uint32_t compile_block(const yaml &schema, StringViewT where);
+
+        template <class SinkT>
+        bool run(uint32_t block, const yaml &node, const path_frame *path, SinkT &sink) const;
+
+        template <class SinkT>
+        bool run_object(const object_rule &rule, const yaml &node, const path_frame *path, SinkT &sink) const;
+
+        ulib::List<instruction> mProgram;
+        ulib::List<property> mProperties;
+        ulib::List<object_rule> mObjects;
+        ulib::List<yaml> mConstants;
+        uint32_t mRoot;
+    };
+
+} // namespace ulib
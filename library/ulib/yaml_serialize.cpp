@@ -1,7 +1,15 @@
 #include "yaml.h"
+#include "yaml_detail.h"
 
 #include <fops/i64toa_10_inl.h>
 
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
 namespace ulib
 {
     namespace yaml_detail
@@ -9,84 +17,774 @@ namespace ulib
         using StringT = typename yaml::StringT;
         using StringViewT = typename yaml::StringViewT;
         using value_t = typename yaml::value_t;
+        using style_t = typename yaml::style_t;
+        using format_t = typename yaml::format_t;
+        using dump_options = typename yaml::dump_options;
 
-        StringT yaml_serialize_value(const yaml &yml, size_t tabs);
-        StringT yaml_serialize_sequence(const yaml &yml, size_t tabs) 
+        enum scalar_char_class : uint8_t
         {
-            StringT result;
+            char_control = 1, // must be escaped, forces double quotes
+            char_flow = 2,    // , [ ] { } end a plain scalar inside flow collections
+            char_colon = 4,   // ':' before a space or at the end starts a mapping value
+            char_hash = 8,    // '#' after a space starts a comment
+        };
 
-            StringT tab;
-            for (size_t i = 0; i != tabs; i++)
-                tab.push_back(' ');
+        struct scalar_char_table
+        {
+            uint8_t classes[256];
 
-            for (auto& val : yml)
+            constexpr scalar_char_table() : classes()
             {
-                result += tab + "- ";
-                if (val.is_map() || val.is_sequence())
-                    result.push_back('\n');
-                
-                result += yaml_serialize_value(val, tabs + 1);
-                result.push_back('\n');
+                for (int c = 0; c != 0x20; c++)
+                    classes[c] = char_control;
+                classes[0x7F] = char_control;
+
+                classes[int(',')] = char_flow;
+                classes[int('[')] = char_flow;
+                classes[int(']')] = char_flow;
+                classes[int('{')] = char_flow;
+                classes[int('}')] = char_flow;
+                classes[int(':')] = char_colon;
+                classes[int('#')] = char_hash;
             }
+        };
 
-            if (!result.empty())
-                result.pop_back(); // remove useless '\n'
+        constexpr scalar_char_table kScalarChars{};
 
-            return result;
+        inline bool is_indicator(char c)
+        {
+            switch (c)
+            {
+            case '-': case '?': case ':': case ',': case '[': case ']': case '{': case '}': case '#':
+            case '&': case '*': case '!': case '|': case '>': case '\'': case '"': case '%': case '@': case '`':
+                return true;
+            default:
+                return false;
+            }
         }
 
+        enum class quoting
+        {
+            plain,
+            quoted,  // printable, double quotes only to keep it a string
+            escaped, // has characters that need escapes
+        };
+
+        // single pass over the bytes with a class table, detailed checks only on the rare special characters
+        quoting scalar_quoting(StringViewT str, bool in_flow)
+        {
+            size_t size = str.size();
+            if (size == 0)
+                return quoting::quoted;
+
+            auto data = (const uint8_t *)str.data();
+
+            uint8_t mask = char_control | char_colon | char_hash | (in_flow ? char_flow : 0);
+            bool quote = false;
+
+            for (size_t i = 0; i != size; i++)
+            {
+                uint8_t cls = kScalarChars.classes[data[i]] & mask;
+                if (!cls)
+                    continue;
+
+                if (cls & char_control)
+                    return quoting::escaped;
+
+                if (cls & char_flow)
+                    quote = true;
+                else if (cls & char_colon)
+                    quote = quote || i + 1 == size || data[i + 1] == ' ' ||
+                            (in_flow && kScalarChars.classes[data[i + 1]] & char_flow);
+                else if (cls & char_hash)
+                    quote = quote || i == 0 || data[i - 1] == ' ';
+            }
+
+            if (quote)
+                return quoting::quoted;
+
+            char first = str.data()[0];
+            if (first == ' ' || str.data()[size - 1] == ' ')
+                return quoting::quoted;
+
+            // "-1", "?x" and ":x" stay plain, "- x" and a lone "-" don't
+            if (is_indicator(first))
+            {
+                bool dashLike = first == '-' || first == '?' || first == ':';
+                if (!dashLike || size == 1 || str.data()[1] == ' ')
+                    return quoting::quoted;
+            }
+
+            // plain forms that read back as something other than this string
+            if (str == "~" || str == "null" || str == "Null" || str == "NULL")
+                return quoting::quoted;
 
-        StringT yaml_serialize_map(const yaml &yml, size_t tabs) 
+            if (size >= 3 && (StringViewT{str.data(), 3} == "---" || StringViewT{str.data(), 3} == "...") &&
+                (size == 3 || str.data()[3] == ' '))
+                return quoting::quoted;
+
+            return quoting::plain;
+        }
+
+        // YAML double-quoted scalar, or a JSON string with \u escapes
+        void write_escaped(StringT &out, StringViewT str, bool json = false)
         {
-            StringT result;
+            static const char kHex[] = "0123456789ABCDEF";
 
-            StringT tab;
-            for (size_t i = 0; i != tabs; i++)
-                tab.push_back(' ');
+            out.push_back('"');
 
-            for (auto& itm : yml.items())
+            auto it = str.data();
+            auto end = it + str.size();
+            while (it != end)
             {
-                result += tab + StringT{itm.name()} + ": ";
+                // copy runs of characters that need no escape at once
+                auto run = it;
+                while (run != end && *run != '"' && *run != '\\' &&
+                       !(kScalarChars.classes[uint8_t(*run)] & char_control))
+                    run++;
 
-                auto& val = itm.value();
-                if (val.is_map() || val.is_sequence())
-                    result.push_back('\n');
+                if (run != it)
+                    out += StringViewT{it, size_t(run - it)};
 
-                result += yaml_serialize_value(itm.value(), tabs + 1);
-                result.push_back('\n');
+                if (run == end)
+                    break;
+
+                char c = *run;
+                switch (c)
+                {
+                case '"': out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\n': out += "\\n"; break;
+                case '\t': out += "\\t"; break;
+                case '\r': out += "\\r"; break;
+                case '\b': out += "\\b"; break;
+                case '\f': out += "\\f"; break;
+                default:
+                    out += json ? "\\u00" : "\\x";
+                    out.push_back(kHex[uint8_t(c) >> 4]);
+                    out.push_back(kHex[uint8_t(c) & 0xF]);
+                    break;
+                }
+
+                it = run + 1;
             }
 
-            if (!result.empty())
-                result.pop_back(); // remove useless '\n'
+            out.push_back('"');
+        }
 
-            return result;
+        void write_scalar(StringT &out, StringViewT str, bool in_flow, bool force_quotes)
+        {
+            if (!force_quotes && scalar_quoting(str, in_flow) == quoting::plain)
+                out += str;
+            else
+                write_escaped(out, str);
         }
 
-        StringT yaml_serialize_value(const yaml &yml, size_t tabs)
+        // shared subtrees referenced more than once are written once with an anchor and then as aliases.
+        // names and first occurrences are fixed before writing, so parts of the document can be written
+        // independently and still agree
+        class anchor_table
         {
-            yaml::value_t t = yml.type();
-            if (t == yaml::value_t::null)
-                return "null";
+        public:
+            // returns the number of nodes written for yml, and the counts of its entries in children
+            size_t count(const yaml &yml, ulib::List<size_t> *children = nullptr)
+            {
+                struct counter : yaml::visitor
+                {
+                    counter(anchor_table &anchors, ulib::List<size_t> *children)
+                        : anchors(anchors), children(children)
+                    {
+                    }
+
+                    bool enter(const yaml &node, const yaml::visit_info &at) override
+                    {
+                        if (at.depth == 1)
+                            entry = nodes;
+                        nodes++;
+
+                        // a subtree is written once, later references are aliases
+                        if (const void *id = node.alias_id())
+                        {
+                            if (anchors.mRefs[id]++)
+                                return false;
+
+                            anchors.mFirst.emplace(id, &node);
+                            anchors.mOrder.push_back(&node);
+                        }
+
+                        return true;
+                    }
+
+                    void leave(const yaml &, const yaml::visit_info &at) override
+                    {
+                        if (at.depth == 1 && children)
+                            children->push_back(nodes - entry);
+                    }
+
+                    anchor_table &anchors;
+                    ulib::List<size_t> *children;
+                    size_t nodes = 0;
+                    size_t entry = 0;
+                };
+
+                counter pass{*this, children};
+                yml.traverse(pass);
+                return pass.nodes;
+            }
+
+            // names in order of first occurrence: the anchor name from parsing if it is free, else a1, a2, ...
+            void assign()
+            {
+                std::unordered_set<std::string_view> names;
+                size_t next = 0;
+
+                for (const yaml *node : mOrder)
+                {
+                    const void *id = node->alias_id();
+                    if (mRefs[id] < 2)
+                        continue;
+
+                    StringT name = node->anchor_name();
+                    while (name.empty() || names.count(std::string_view{name.data(), name.size()}))
+                        name = StringT{"a"} + std::to_string(++next);
+
+                    auto &stored = mNames.emplace(id, name).first->second;
+                    names.insert(std::string_view{stored.data(), stored.size()});
+                }
+            }
 
-            if (t == yaml::value_t::scalar)
-                return yml.scalar();
+            // anchor to write before the node, set for the first occurrence of a subtree with several references.
+            // later occurrences set alias and are written as "*name" instead of the node
+            const StringT *mark(const yaml &yml, bool &alias) const
+            {
+                alias = false;
+
+                const void *id = yml.alias_id();
+                if (!id)
+                    return nullptr;
+
+                auto it = mNames.find(id);
+                if (it == mNames.end())
+                    return nullptr;
 
-            if (t == yaml::value_t::map)
-                return yaml_serialize_map(yml, tabs);
+                alias = mFirst.at(id) != &yml;
+                return &it->second;
+            }
+
+        private:
+            std::unordered_map<const void *, size_t> mRefs;
+            std::unordered_map<const void *, const yaml *> mFirst;
+            std::unordered_map<const void *, StringT> mNames;
+            ulib::List<const yaml *> mOrder;
+        };
 
-            if (t == yaml::value_t::sequence)
-                return yaml_serialize_sequence(yml, tabs);
+        // positions of the items of a map in key order, equal keys keep their order
+        ulib::List<size_t> key_order(const yaml &yml)
+        {
+            auto items = yml.items();
 
-            throw yaml::internal_error{
-                "[yaml.internal_error] yaml_detail::yaml_serialize_value(): got invalid yaml type " +
-                std::to_string((int)t)};
+            ulib::List<size_t> order;
+            order.reserve(items.size());
+            for (size_t i = 0; i != items.size(); i++)
+                order.push_back(i);
+
+            size_t *first = order.data();
+            std::stable_sort(first, first + order.size(), [&](size_t left, size_t right) {
+                return compare_bytes(items[left].name(), items[right].name()) < 0;
+            });
+
+            return order;
         }
 
-    } // namespace json_detail
+        // writes a document, or a range of its top-level entries, into one buffer
+        class serializer
+        {
+        public:
+            serializer(StringT &out, const dump_options &options, const anchor_table &anchors)
+                : mOut(out), mOptions(options), mAnchors(anchors)
+            {
+            }
+
+            // true if write_entries() can split the root
+            bool splittable(const yaml &yml) const
+            {
+                if (mOptions.format == format_t::json)
+                    return yml.is_map() || yml.is_sequence();
+
+                return is_block(yml);
+            }
+
+            // entries [from, to) of the root with the separator before them, the document prefix before the
+            // first entry and the suffix after the last one. consecutive ranges add up to write_root()
+            void write_entries(const yaml &yml, size_t from, size_t to, size_t total)
+            {
+                if (mOptions.format == format_t::json)
+                {
+                    bool map = yml.is_map();
+                    if (from == 0)
+                        mOut.push_back(map ? '{' : '[');
+
+                    write_json_range(yml, from, to);
+
+                    if (to == total)
+                        mOut.push_back(map ? '}' : ']');
+                    return;
+                }
+
+                bool alias;
+                if (from == 0)
+                    if (auto anchor = mAnchors.mark(yml, alias))
+                    {
+                        mOut.push_back('&');
+                        mOut += *anchor;
+                        mOut.push_back('\n');
+                    }
+
+                write_block_range(yml, 0, from, to);
+            }
+
+            void write_root(const yaml &yml)
+            {
+                if (mOptions.format == format_t::json)
+                {
+                    write_json(yml);
+                    return;
+                }
+
+                bool alias;
+                if (auto anchor = mAnchors.mark(yml, alias))
+                {
+                    mOut.push_back(alias ? '*' : '&');
+                    mOut += *anchor;
+                    if (alias)
+                        return;
+
+                    mOut.push_back(is_block(yml) ? '\n' : ' ');
+                }
+
+                if (is_block(yml))
+                    write_block(yml, 0);
+                else
+                    write_flow(yml, false);
+            }
+
+        private:
+            // the writer recurses once per collection, documents nested deeper than max_depth are rejected
+            // instead of running out of stack
+            struct nested
+            {
+                nested(size_t &depth) : depth(depth)
+                {
+                    if (++depth > yaml::max_depth)
+                        throw yaml::value_error{ulib::string{"[yaml.value_error] ulib::yaml.dump(): document nested "
+                                                             "deeper than "} +
+                                                std::to_string(yaml::max_depth) + " levels"};
+                }
+                ~nested() { depth--; }
+
+                size_t &depth;
+            };
+
+            // canonical output doesn't depend on how the document was written
+            style_t style_of(const yaml &yml) const { return mOptions.canonical ? style_t::any : yml.style(); }
+
+            // calls fn with the items [from, to) of a map in output order
+            template <class FnT>
+            void for_items(const yaml &yml, size_t from, size_t to, FnT &&fn) const
+            {
+                auto items = yml.items();
+                if (!mOptions.canonical || yml.sorted())
+                {
+                    for (size_t i = from; i != to; i++)
+                        fn(i, items[i]);
+                    return;
+                }
+
+                auto order = key_order(yml);
+                for (size_t i = from; i != to; i++)
+                    fn(i, items[order[i]]);
+            }
+
+            bool is_block(const yaml &yml) const
+            {
+                if (mOptions.format != format_t::block)
+                    return false;
+
+                size_t size;
+                if (yml.is_map())
+                    size = yml.items().size();
+                else if (yml.is_sequence())
+                    size = yml.size();
+                else
+                    return false;
 
-    typename yaml::StringT yaml::yaml_serialize(const yaml &yml)
+                style_t style = style_of(yml);
+                if (size == 0 || style == style_t::flow)
+                    return false;
+
+                if (style == style_t::block || mOptions.flow_threshold == 0)
+                    return true;
+
+                size_t budget = mOptions.flow_threshold;
+                return !fits(yml, budget, mDepth);
+            }
+
+            // true if the nodes under yml don't exceed budget, stops counting as soon as they do. a subtree too
+            // deep to write doesn't fit either, the writer then reports it
+            static bool fits(const yaml &yml, size_t &budget, size_t depth)
+            {
+                if (depth > yaml::max_depth)
+                    return false;
+
+                if (yml.is_map())
+                {
+                    for (auto &itm : yml.items())
+                        if (budget-- == 0 || !fits(itm.value(), budget, depth + 1))
+                            return false;
+                }
+                else if (yml.is_sequence())
+                {
+                    for (auto &val : yml.values())
+                        if (budget-- == 0 || !fits(val, budget, depth + 1))
+                            return false;
+                }
+
+                return true;
+            }
+
+            void indent(size_t level)
+            {
+                for (size_t i = 0, count = level * mOptions.indent; i != count; i++)
+                    mOut.push_back(' ');
+            }
+
+            // "key:" or "-" is already written
+            void write_entry(const yaml &val, size_t level)
+            {
+                bool alias;
+                if (auto anchor = mAnchors.mark(val, alias))
+                {
+                    mOut += alias ? " *" : " &";
+                    mOut += *anchor;
+                    if (alias)
+                        return;
+                }
+
+                if (is_block(val))
+                {
+                    mOut.push_back('\n');
+                    write_block(val, level + 1);
+                }
+                else
+                {
+                    mOut.push_back(' ');
+                    write_flow(val, false);
+                }
+            }
+
+            void write_block(const yaml &yml, size_t level)
+            {
+                write_block_range(yml, level, 0, yml.is_map() ? yml.items().size() : yml.size());
+            }
+
+            void write_block_range(const yaml &yml, size_t level, size_t from, size_t to)
+            {
+                nested guard{mDepth};
+                if (yml.is_map())
+                {
+                    for_items(yml, from, to, [&](size_t i, const yaml::ItemT &itm) {
+                        if (i != 0)
+                            mOut.push_back('\n');
+
+                        indent(level);
+                        write_scalar(mOut, itm.name(), false, false);
+                        mOut.push_back(':');
+                        write_entry(itm.value(), level);
+                    });
+                }
+                else
+                {
+                    auto values = yml.values();
+                    for (size_t i = from; i != to; i++)
+                    {
+                        if (i != 0)
+                            mOut.push_back('\n');
+
+                        indent(level);
+                        mOut.push_back('-');
+                        write_entry(values[i], level);
+                    }
+                }
+            }
+
+            // in_flow is set inside a flow collection, where scalars with flow indicators need quotes
+            void write_flow(const yaml &yml, bool in_flow)
+            {
+                switch (yml.type())
+                {
+                case value_t::null:
+                    mOut += "null";
+                    return;
+
+                case value_t::scalar:
+                    write_scalar(mOut, yml.scalar(), in_flow, style_of(yml) == style_t::quoted);
+                    return;
+
+                case value_t::map: {
+                    nested guard{mDepth};
+                    mOut.push_back('{');
+
+                    for_items(yml, 0, yml.items().size(), [&](size_t i, const yaml::ItemT &itm) {
+                        if (i != 0)
+                            mOut += ", ";
+
+                        write_scalar(mOut, itm.name(), true, false);
+                        mOut += ": ";
+                        write_flow_entry(itm.value());
+                    });
+
+                    mOut.push_back('}');
+                    return;
+                }
+
+                case value_t::sequence: {
+                    nested guard{mDepth};
+                    mOut.push_back('[');
+
+                    bool first = true;
+                    for (auto &val : yml.values())
+                    {
+                        if (!first)
+                            mOut += ", ";
+                        first = false;
+
+                        write_flow_entry(val);
+                    }
+
+                    mOut.push_back(']');
+                    return;
+                }
+                }
+
+                throw yaml::internal_error{
+                    "[yaml.internal_error] yaml_detail::serializer::write_flow(): got invalid yaml type " +
+                    std::to_string((int)yml.type())};
+            }
+
+            void write_flow_entry(const yaml &val)
+            {
+                bool alias;
+                if (auto anchor = mAnchors.mark(val, alias))
+                {
+                    mOut.push_back(alias ? '*' : '&');
+                    mOut += *anchor;
+                    if (alias)
+                        return;
+
+                    mOut.push_back(' ');
+                }
+
+                write_flow(val, true);
+            }
+
+            // aliases are expanded, JSON has no references
+            void write_json(const yaml &yml)
+            {
+                switch (yml.type())
+                {
+                case value_t::null:
+                    mOut += "null";
+                    return;
+
+                case value_t::scalar: {
+                    StringViewT text = yml.scalar();
+                    if (style_of(yml) != style_t::quoted && (text == "true" || text == "false" || is_json_number(text)))
+                        mOut += text;
+                    else
+                        write_escaped(mOut, text, true);
+                    return;
+                }
+
+                case value_t::map:
+                    mOut.push_back('{');
+                    write_json_range(yml, 0, yml.items().size());
+                    mOut.push_back('}');
+                    return;
+
+                case value_t::sequence:
+                    mOut.push_back('[');
+                    write_json_range(yml, 0, yml.size());
+                    mOut.push_back(']');
+                    return;
+                }
+
+                throw yaml::internal_error{
+                    "[yaml.internal_error] yaml_detail::serializer::write_json(): got invalid yaml type " +
+                    std::to_string((int)yml.type())};
+            }
+
+            void write_json_range(const yaml &yml, size_t from, size_t to)
+            {
+                nested guard{mDepth};
+                if (yml.is_map())
+                {
+                    for_items(yml, from, to, [&](size_t i, const yaml::ItemT &itm) {
+                        if (i != 0)
+                            mOut.push_back(',');
+
+                        write_escaped(mOut, itm.name(), true);
+                        mOut.push_back(':');
+                        write_json(itm.value());
+                    });
+                }
+                else
+                {
+                    auto values = yml.values();
+                    for (size_t i = from; i != to; i++)
+                    {
+                        if (i != 0)
+                            mOut.push_back(',');
+
+                        write_json(values[i]);
+                    }
+                }
+            }
+
+            StringT &mOut;
+            const dump_options &mOptions;
+            const anchor_table &mAnchors;
+            size_t mDepth = 0;
+        };
+
+        // the document as consecutive parts. large block or JSON collections are split by top-level entries into
+        // ranges of about the same node count, which are written on their own threads
+        ulib::List<StringT> serialize_parts(const yaml &yml, const dump_options &options)
+        {
+            // nested block collections would start at the column of their parent and read back as siblings
+            if (options.format == format_t::block && options.indent == 0)
+                throw yaml::value_error{"[yaml.value_error] ulib::yaml.dump(): indent must be at least 1"};
+
+            size_t threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+
+            anchor_table anchors;
+            ulib::List<size_t> sizes;
+            size_t total = 0;
+            if ((options.format != format_t::json && !options.canonical) || threads > 1)
+                total = anchors.count(yml, threads > 1 ? &sizes : nullptr);
+
+            // canonical output expands aliases, no node gets an anchor
+            if (!options.canonical)
+                anchors.assign();
+
+            // the ranges are cut in output order
+            if (options.canonical && yml.is_map() && !yml.sorted() && sizes.size() > 1)
+            {
+                ulib::List<size_t> ordered;
+                for (size_t i : key_order(yml))
+                    ordered.push_back(sizes[i]);
+                sizes = std::move(ordered);
+            }
+
+            ulib::List<StringT> parts;
+
+            StringT whole;
+            serializer single{whole, options, anchors};
+            if (threads < 2 || sizes.size() < 2 || total < options.parallel_min_nodes || !single.splittable(yml))
+            {
+                single.write_root(yml);
+                parts.push_back(std::move(whole));
+                return parts;
+            }
+
+            // cut points at equal shares of the node count
+            ulib::List<size_t> bounds;
+            bounds.push_back(0);
+
+            size_t count = std::min(threads, sizes.size());
+            size_t done = 0;
+            for (size_t i = 0; i != sizes.size(); i++)
+            {
+                done += sizes[i];
+                if (bounds.size() < count && done * count >= total * bounds.size() && i + 1 != sizes.size())
+                    bounds.push_back(i + 1);
+            }
+            bounds.push_back(sizes.size());
+
+            size_t partCount = bounds.size() - 1;
+            for (size_t i = 0; i != partCount; i++)
+                parts.emplace_back();
+
+            ulib::List<std::exception_ptr> errors;
+            for (size_t i = 0; i != partCount; i++)
+                errors.emplace_back();
+
+            {
+                ulib::List<std::thread> workers;
+                for (size_t i = 1; i < partCount; i++)
+                    workers.emplace_back([&, i]() {
+                        try
+                        {
+                            serializer{parts[i], options, anchors}.write_entries(yml, bounds[i], bounds[i + 1],
+                                                                                 sizes.size());
+                        }
+                        catch (...)
+                        {
+                            errors[i] = std::current_exception();
+                        }
+                    });
+
+                try
+                {
+                    serializer{parts[0], options, anchors}.write_entries(yml, bounds[0], bounds[1], sizes.size());
+                }
+                catch (...)
+                {
+                    errors[0] = std::current_exception();
+                }
+
+                for (auto &worker : workers)
+                    worker.join();
+            }
+
+            for (auto &error : errors)
+                if (error)
+                    std::rethrow_exception(error);
+
+            return parts;
+        }
+
+    } // namespace yaml_detail
+
+    typename yaml::StringT yaml::yaml_serialize(const yaml &yml, const dump_options &options)
     {
-        return yaml_detail::yaml_serialize_value(yml, 0);
+        auto parts = yaml_detail::serialize_parts(yml, options);
+        if (parts.size() == 1)
+            return std::move(parts[0]);
+
+        StringT result;
+        for (auto &part : parts)
+            result += part;
+
+        return result;
+    }
+
+    void yaml::dump_file(StringViewT path) const
+    {
+        dump_file(path, dump_options{});
+    }
+
+    void yaml::dump_file(StringViewT path, const dump_options &options) const
+    {
+        auto parts = yaml_detail::serialize_parts(*this, options);
+
+        std::ofstream out{std::string{path.data(), path.size()}, std::ios::binary | std::ios::trunc};
+        for (auto &part : parts)
+            out.write(part.data(), std::streamsize(part.size()));
+
+        out.close();
+        if (!out)
+            throw yaml::exception{ulib::string{"[yaml.exception] ulib::yaml::dump_file(\""} + path +
+                                  "\"): can't write file"};
     }
 
 } // namespace ulib
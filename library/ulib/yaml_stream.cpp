@@ -0,0 +1,561 @@
+#include "yaml.h"
+#include "yaml_detail.h"
+
+#include <cstring>
+
+namespace ulib
+{
+    using StringViewT = typename yaml::StringViewT;
+
+    static bool blank(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+    // only blanks or a comment from pos to the line end
+    static bool blank_rest(const char *data, size_t size, size_t pos, bool final, bool &wait)
+    {
+        for (; pos < size && data[pos] != '\n'; pos++)
+        {
+            if (data[pos] == '#')
+                return true;
+            if (!blank(data[pos]))
+                return false;
+        }
+
+        wait = pos >= size && !final;
+        return true;
+    }
+
+    // the byte at i, past the end it is a line end once the input is complete. false if it isn't known yet
+    static bool peek(const char *data, size_t size, size_t i, bool final, bool &wait, char &c)
+    {
+        if (i < size)
+            return c = data[i], true;
+
+        wait = !final;
+        c = '\n';
+        return final;
+    }
+
+    bool yaml::entry_scanner::next(const char *data, size_t size, size_t &pos, bool final)
+    {
+        if (mEnded)
+            return false;
+
+        // the first line is an entry or a document marker like any other
+        if (!mStarted && pos < size)
+        {
+            bool wait = false;
+            bool entry = entry_line(data, size, pos, final, wait);
+            bool marker = !entry && !wait && document_marker(data, size, pos, final, wait);
+            bool inlineRoot = marker && !blank_rest(data, size, pos + 3, final, wait);
+            if (wait)
+                return false;
+
+            mStarted = true;
+            mMarkers += marker;
+            mIrregular = mIrregular || inlineRoot;
+            if (entry)
+            {
+                mContent = data[pos] != '%';
+                return true;
+            }
+        }
+
+        while (pos < size)
+        {
+            char c = data[pos];
+
+            if (mQuote == '"')
+            {
+                if (mEscape)
+                    mEscape = false;
+                else if (c == '\\')
+                    mEscape = true;
+                else if (c == '"')
+                    mQuote = 0, mPrev = c;
+
+                pos++;
+                mColumn = c == '\n' ? 0 : mColumn + 1;
+                continue;
+            }
+
+            if (mQuote == '\'')
+            {
+                if (c == '\'')
+                {
+                    // '' is an escaped quote, the next byte decides
+                    if (pos + 1 == size && !final)
+                        return false;
+
+                    if (pos + 1 != size && data[pos + 1] == '\'')
+                        pos++, mColumn++;
+                    else
+                        mQuote = 0, mPrev = c;
+                }
+
+                pos++;
+                mColumn = c == '\n' ? 0 : mColumn + 1;
+                continue;
+            }
+
+            if (c == '\n')
+            {
+                if (pos + 1 == size)
+                {
+                    if (final)
+                        pos++, finish();
+                    return false;
+                }
+
+                // block scalar content is indented, a line at column 0 ends it
+                char next = data[pos + 1];
+                if (mBlockScalar && next != ' ' && next != '\t' && next != '\r' && next != '\n')
+                    mBlockScalar = false;
+
+                bool wait = false;
+                bool entry = !mBlockScalar && mFlow == 0 && entry_line(data, size, pos + 1, final, wait);
+                bool marker = !entry && !wait && mFlow == 0 && document_marker(data, size, pos + 1, final, wait);
+                bool inlineRoot = marker && !blank_rest(data, size, pos + 4, final, wait);
+                if (wait)
+                    return false;
+
+                mComment = false;
+                mSpace = false;
+                mLineStart = true;
+                mPlain = mPlain && mPrev != ':';
+                mPrev = '\n';
+                mToken = mLastToken = 0;
+                mColumn = 0;
+                pos++;
+
+                // "---" after content or after a first "---" starts the second document, "..." ends the first
+                if (marker && (mContent || mMarkers++ != 0 || data[pos] == '.'))
+                {
+                    mEnded = true;
+                    return true;
+                }
+
+                // a root that starts on the "---" line isn't split
+                if (inlineRoot)
+                    mIrregular = true;
+
+                if (entry)
+                {
+                    mContent = mContent || data[pos] != '%';
+                    return true;
+                }
+                continue;
+            }
+
+            pos++;
+            size_t column = mColumn++;
+
+            if (mLineStart && c != ' ' && c != '\t' && c != '\r')
+            {
+                mLineStart = false;
+                if (mBlockScalar && column <= mBlockColumn)
+                    mBlockScalar = false;
+
+                // an indented root isn't split
+                if (!mRoot && column != 0 && c != '#' && !mBlockScalar && !mQuote)
+                    mIrregular = true;
+
+                // a line indented past the owner of an open plain scalar continues it, the indicators on it are text
+                if (mPlain && column <= mPlainColumn)
+                    mPlain = false;
+                else if (mPlain && !mFlow && c != '#' && std::strchr("\"'[]{}|>&*!", c))
+                    mIrregular = true;
+            }
+
+            if (mComment || mBlockScalar)
+                continue;
+
+            if (c == ' ' || c == '\t' || c == '\r')
+            {
+                // ": " ends a key
+                if (mPrev == ':')
+                    mPlain = false;
+
+                mSpace = true;
+                continue;
+            }
+
+            bool tokenStart = mSpace || mPrev == '\n' || (mFlow && (mPrev == '[' || mPrev == '{' || mPrev == ','));
+
+            // first token of the line, or the first after a "- " item indicator
+            bool nodeStart = tokenStart && !mFlow && (mPrev == '\n' || (mPrev == '-' && mToken == '-'));
+            bool valueStart = mPrev == '\n' || mPrev == ':' || mPrev == '-' || mPrev == '?' || mPrev == ',' ||
+                              mPrev == '[' || mPrev == '{';
+            mSpace = false;
+
+            if (tokenStart)
+            {
+                mLastToken = mToken;
+                mToken = c;
+
+                // a tag or an anchor comes before the value
+                if (mLastToken == '!' || mLastToken == '&')
+                    valueStart = true;
+            }
+
+            if (tokenStart && valueStart && !mFlow && !(mPrev == '\n' && mPlain))
+            {
+                char next = pos < size ? data[pos] : ' ';
+                mPlain = !std::strchr("\"'[]{},#&*!|>%@`", c) && !((c == '-' || c == '?' || c == ':') && blank(next));
+                mPlainColumn = mNodeColumn;
+            }
+
+            if (c == '#' && tokenStart)
+                mComment = true, mPlain = false;
+            else if ((c == '"' || c == '\'') && tokenStart && valueStart)
+                mQuote = c;
+            else if ((c == '[' || c == '{') && tokenStart && valueStart)
+                mFlow++;
+            else if ((c == ']' || c == '}') && mFlow)
+                mFlow--;
+            else if ((c == '|' || c == '>') && tokenStart && valueStart && !mFlow)
+                mBlockScalar = true, mBlockColumn = mNodeColumn;
+            else if (c == '&' && tokenStart)
+                mAnchors = true;
+
+            if (nodeStart && !mBlockScalar)
+                mNodeColumn = column;
+
+            mPrev = c;
+        }
+
+        if (final)
+            finish();
+        return false;
+    }
+
+    // a quote or a flow collection left open at the end may have taken in entries that the parser reads
+    // differently
+    void yaml::entry_scanner::finish()
+    {
+        if (mQuote || mFlow)
+            mIrregular = true;
+    }
+
+    // a line that starts at column 0 with content starts a new top-level key or sequence item,
+    // except for document markers and the ':' of an explicit key
+    bool yaml::entry_scanner::starts_entry(const char *data, size_t size, size_t pos, bool final, bool &wait)
+    {
+        if (pos >= size)
+        {
+            wait = !final;
+            return false;
+        }
+
+        char c = data[pos];
+        switch (c)
+        {
+        case ' ': case '\t': case '\r': case '\n': case '#': case ':': case ']': case '}':
+            return false;
+
+        case '-':
+        case '.':
+            if (size - pos < 4 && !final)
+            {
+                wait = true;
+                return false;
+            }
+
+            for (size_t i = 1; i != 3; i++)
+                if (pos + i == size || data[pos + i] != c)
+                    return true;
+
+            return !(pos + 3 == size || data[pos + 3] == ' ' || data[pos + 3] == '\r' || data[pos + 3] == '\n');
+
+        default:
+            return true;
+        }
+    }
+
+    bool yaml::entry_scanner::entry_line(const char *data, size_t size, size_t pos, bool final, bool &wait)
+    {
+        if (!starts_entry(data, size, pos, final, wait))
+        {
+            // the value of an explicit key, a stray flow indicator or a tab where indentation belongs
+            if (pos < size && (data[pos] == ':' || data[pos] == ']' || data[pos] == '}' || data[pos] == '\t'))
+                mIrregular = true;
+            return false;
+        }
+
+        char c = data[pos];
+        if (c == '%')
+            return true;
+
+        char next;
+        if (!peek(data, size, pos + 1, final, wait, next))
+            return false;
+
+        bool item = c == '-' && blank(next);
+        bool key = !item && key_line(data, size, pos, final, wait);
+        if (wait)
+            return false;
+
+        // a first line that is neither an item nor a key starts a scalar root, which isn't split
+        if (!mRoot)
+            mRoot = item ? 's' : key ? 'm' : 'x';
+
+        // "- " lines in a map are a sequence value of the key before. anything else would be read differently
+        // on its own than together with the line before
+        if (mRoot == 's' ? item : mRoot == 'm' ? key : false)
+            return true;
+
+        if (mRoot != 'm' || !item)
+            mIrregular = true;
+        return false;
+    }
+
+    // a simple key: a plain scalar that doesn't start with an indicator or a quoted scalar on one line, followed
+    // by ':' and a blank before any comment
+    bool yaml::entry_scanner::key_line(const char *data, size_t size, size_t pos, bool final, bool &wait)
+    {
+        auto at = [&](size_t i, char &c) { return peek(data, size, i, final, wait, c); };
+
+        size_t i = pos;
+        char c = data[pos];
+        switch (c)
+        {
+        case ',': case '[': case ']': case '{': case '}': case '#': case '&': case '*': case '!': case '|':
+        case '>': case '%': case '@': case '`':
+            return false;
+
+        case '-': case '?': case ':': {
+            char next;
+            if (!at(pos + 1, next) || blank(next))
+                return false;
+            break;
+        }
+
+        case '"':
+        case '\'':
+            for (i++;; i++)
+            {
+                char q;
+                if (!at(i, q) || q == '\n')
+                    return false;
+
+                if (c == '"' && q == '\\')
+                {
+                    i++;
+                }
+                else if (q == c)
+                {
+                    // '' is an escaped quote
+                    char after;
+                    if (c == '\'' && at(i + 1, after) && after == '\'')
+                        i++;
+                    else if (!wait)
+                        break;
+                    else
+                        return false;
+                }
+            }
+
+            for (i++;; i++)
+            {
+                char k;
+                if (!at(i, k) || (k != ' ' && k != ':'))
+                    return false;
+
+                if (k == ':')
+                    break;
+            }
+
+            {
+                char after;
+                return at(i + 1, after) && blank(after);
+            }
+
+        default:
+            break;
+        }
+
+        for (;; i++)
+        {
+            char k;
+            if (!at(i, k) || k == '\n')
+                return false;
+
+            if (k == '#' && i != pos && blank(data[i - 1]))
+                return false;
+
+            if (k == ':')
+            {
+                char after;
+                if (!at(i + 1, after))
+                    return false;
+                if (blank(after))
+                    return true;
+            }
+        }
+    }
+
+    bool yaml::entry_scanner::document_marker(const char *data, size_t size, size_t pos, bool final, bool &wait)
+    {
+        char c = data[pos];
+        if (c != '-' && c != '.')
+            return false;
+
+        if (size - pos < 4 && !final)
+        {
+            wait = true;
+            return false;
+        }
+
+        for (size_t i = 1; i != 3; i++)
+            if (pos + i == size || data[pos + i] != c)
+                return false;
+
+        return pos + 3 == size || data[pos + 3] == ' ' || data[pos + 3] == '\t' || data[pos + 3] == '\r' ||
+               data[pos + 3] == '\n';
+    }
+
+    yaml::stream_parser::stream_parser(const parse_options &options)
+        : mOptions(options), mStart(0), mScan(0), mIncremental(true), mStarted(false), mFinished(false),
+          mEnded(false), mValidate(options.validate_utf8), mValidated(0), mScanner(new entry_scanner)
+    {
+        if (!mOptions.keys)
+            mOptions.keys = &mKeys;
+
+        // the chunks are checked as they arrive, the pieces aren't checked again
+        mOptions.validate_utf8 = false;
+    }
+
+    yaml::stream_parser::~stream_parser() {}
+
+    void yaml::stream_parser::feed(StringViewT chunk)
+    {
+        if (mFinished)
+            throw yaml::exception{"[yaml.exception] ulib::yaml::stream_parser::feed(): the parser is finished"};
+
+        // only the first document is read
+        if (mEnded)
+            return;
+
+        mBuffer.append(chunk.data(), chunk.size());
+
+        // a sequence cut off by the chunk end is checked with the next chunk
+        if (mValidate)
+        {
+            size_t complete;
+            size_t size = mBuffer.size() - mValidated;
+            if (yaml_detail::validate_utf8(mBuffer.data() + mValidated, size, complete) != size)
+                throw parse_error{"[yaml.parse_error] ulib::yaml::stream_parser::feed(): invalid UTF-8"};
+
+            mValidated += complete;
+        }
+
+        if (!mStarted)
+        {
+            // entries can only be split at line starts of a block collection root
+            auto first = mBuffer.find_first_not_of(" \t\r\n");
+            if (first == std::string::npos)
+                return;
+
+            mStarted = true;
+            mIncremental = mBuffer[first] != '{' && mBuffer[first] != '[';
+        }
+
+        while (mIncremental && mScanner->next(mBuffer.data(), mBuffer.size(), mScan, false))
+        {
+            // aliases can't reach anchors in an earlier piece, the rest goes to finish() in one piece
+            if (mScanner->anchors() || mScanner->irregular())
+            {
+                mIncremental = false;
+                break;
+            }
+
+            if (mScanner->ended())
+            {
+                mBuffer.resize(mScan);
+                mEnded = true;
+                break;
+            }
+
+            // everything before this line is complete
+            if (parse_entries(mStart, mScan))
+                mStart = mScan;
+        }
+
+        // drop parsed input once it is the larger part of the buffer
+        if (mStart != 0 && mStart >= mBuffer.size() / 2)
+        {
+            mBuffer.erase(0, mStart);
+            mScan -= mStart;
+            mValidated -= mValidate ? mStart : 0;
+            mStart = 0;
+        }
+    }
+
+    yaml yaml::stream_parser::finish()
+    {
+        if (mFinished)
+            throw yaml::exception{"[yaml.exception] ulib::yaml::stream_parser::finish(): the parser is finished"};
+        mFinished = true;
+
+        if (mValidate && mValidated < mBuffer.size())
+            throw parse_error{"[yaml.parse_error] ulib::yaml::stream_parser::finish(): input ends inside a UTF-8 "
+                              "sequence"};
+
+        StringViewT rest{mBuffer.data() + mStart, mBuffer.size() - mStart};
+        if (mIncremental)
+            merge(parse_yaml_json(rest, mOptions));
+        else
+            merge(parse(rest, mOptions));
+
+        mBuffer.clear();
+        return std::move(mDocument);
+    }
+
+    bool yaml::stream_parser::parse_entries(size_t from, size_t to)
+    {
+        StringViewT text{mBuffer.data() + from, to - from};
+
+        yaml piece;
+        try
+        {
+            piece = parse_yaml_json(text, mOptions);
+        }
+        catch (const std::exception &)
+        {
+            // e.g. a quoted scalar continued at column 0, the piece is retried together with the next entry
+            return false;
+        }
+
+        merge(std::move(piece));
+        return true;
+    }
+
+    void yaml::stream_parser::merge(yaml &&piece)
+    {
+        if (piece.mType == value_t::null && !piece.mIndirect)
+            return;
+
+        if (mDocument.mType == value_t::null && !mDocument.mIndirect)
+        {
+            mDocument = std::move(piece);
+            return;
+        }
+
+        if (mDocument.mType == value_t::map && piece.mType == value_t::map)
+        {
+            for (auto &itm : piece.mMap)
+                mDocument.find_or_create(itm.key()) = std::move(itm.value());
+            return;
+        }
+
+        if (mDocument.mType == value_t::sequence && piece.mType == value_t::sequence)
+        {
+            for (auto &val : piece.mSequence)
+                mDocument.mSequence.push_back(std::move(val));
+            return;
+        }
+
+        throw yaml::parse_error{
+            "[yaml.parse_error] ulib::yaml::stream_parser::feed(): top-level entries must all be map items or "
+            "all be sequence items"};
+    }
+} // namespace ulib
@@ -0,0 +1,216 @@
+#include "yaml.h"
+#include "yaml_detail.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace ulib
+{
+    using table = typename yaml::table;
+    using value_t = typename yaml::value_t;
+
+    void table::column::push_back(StringViewT cell)
+    {
+        size_t at = mChars.size();
+        if (cell.size())
+        {
+            mChars.resize(at + cell.size());
+            std::memcpy(mChars.data() + at, cell.data(), cell.size() * sizeof(CharT));
+        }
+
+        mOffsets.push_back(mChars.size());
+        mNulls.push_back(0);
+    }
+
+    void table::column::push_null()
+    {
+        mOffsets.push_back(mChars.size());
+        mNulls.push_back(1);
+    }
+
+    size_t table::column::allocated() const
+    {
+        return mChars.capacity() * sizeof(CharT) + mOffsets.capacity() * sizeof(size_t) +
+               mNulls.capacity() * sizeof(uint8_t) + mIntegers.capacity() * sizeof(int64_t) +
+               mFloats.capacity() * sizeof(double);
+    }
+
+    void table::column::infer_type()
+    {
+        bool integers = true;
+        bool decimals = true;
+        bool any = false;
+
+        for (size_t i = 0; i != size() && (integers || decimals); i++)
+        {
+            if (is_null(i))
+                continue;
+
+            any = true;
+            StringViewT cell = scalar(i);
+
+            integers = integers && yaml_detail::is_integer_text(cell);
+            decimals = decimals && yaml_detail::is_decimal_text(cell);
+        }
+
+        mType = column_t::string;
+        mIntegers.clear();
+        mFloats.clear();
+
+        if (!any || !(integers || decimals))
+            return;
+
+        if (integers)
+        {
+            mType = column_t::integer;
+            mIntegers.resize(size());
+            for (size_t i = 0; i != size(); i++)
+                mIntegers[i] = is_null(i) ? 0 : yaml::parse_integer(scalar(i));
+        }
+        else
+        {
+            mType = column_t::floating;
+            mFloats.resize(size());
+            for (size_t i = 0; i != size(); i++)
+                mFloats[i] = is_null(i) ? 0.0 : yaml::parse_float(scalar(i));
+        }
+    }
+
+    table::table(span<const KeyT> keys)
+    {
+        mKeys.reserve(keys.size());
+        mColumns.reserve(keys.size());
+
+        for (auto &key : keys)
+        {
+            mKeys.push_back(key);
+            mColumns.emplace_back();
+        }
+    }
+
+    std::optional<table> table::from(const yaml &sequence)
+    {
+        if (!sequence.is_sequence())
+            return std::nullopt;
+
+        // rows without keys would leave no column to count them
+        auto rows = sequence.values();
+        if (rows.size() == 0 || !rows[0].is_map() || rows[0].items().size() == 0)
+            return std::nullopt;
+
+        ulib::List<KeyT> keys;
+        for (auto &itm : rows[0].items())
+            keys.push_back(itm.key());
+
+        table result{keys};
+        for (auto &row : rows)
+        {
+            if (!row.is_map())
+                return std::nullopt;
+
+            auto items = row.items();
+            if (items.size() != keys.size())
+                return std::nullopt;
+
+            for (size_t i = 0; i != items.size(); i++)
+            {
+                auto &itm = items[i];
+                if (!itm.key().same(keys[i]) && !itm.key().equals(keys[i].str(), keys[i].hash()))
+                    return std::nullopt;
+
+                auto &value = itm.value();
+                if (value.is_null())
+                    result.mColumns[i].push_null();
+                else if (value.is_scalar())
+                    result.mColumns[i].push_back(value.scalar());
+                else
+                    return std::nullopt;
+            }
+        }
+
+        result.freeze();
+        result.mSorted = rows[0].sorted();
+        return result;
+    }
+
+    const table::column *table::find(StringViewT key) const
+    {
+        uint64_t hash = KeyT::hash_of(key);
+        for (size_t i = 0; i != mKeys.size(); i++)
+            if (mKeys[i].equals(key, hash))
+                return &mColumns[i];
+
+        return nullptr;
+    }
+
+    void table::freeze()
+    {
+        for (auto &col : mColumns)
+            col.infer_type();
+    }
+
+    void table::sort_keys()
+    {
+        ulib::List<size_t> order;
+        for (size_t i = 0; i != mKeys.size(); i++)
+            order.push_back(i);
+
+        size_t *first = order.data();
+        std::stable_sort(first, first + order.size(), [&](size_t left, size_t right) {
+            return yaml_detail::compare_bytes(mKeys[left].str(), mKeys[right].str()) < 0;
+        });
+
+        ulib::List<KeyT, AllocatorT> keys;
+        ulib::List<column, AllocatorT> columns;
+        keys.reserve(mKeys.size());
+        columns.reserve(mColumns.size());
+        for (size_t i : order)
+        {
+            keys.push_back(mKeys[i]);
+            columns.push_back(std::move(mColumns[i]));
+        }
+
+        mKeys = std::move(keys);
+        mColumns = std::move(columns);
+        mSorted = true;
+    }
+
+    size_t table::allocated() const
+    {
+        size_t bytes = mKeys.capacity() * sizeof(KeyT) + mColumns.capacity() * sizeof(column);
+        for (auto &col : mColumns)
+            bytes += col.allocated();
+
+        return bytes;
+    }
+
+    yaml table::row(size_t idx) const
+    {
+        yaml result{value_t::map};
+        result.mSorted = mSorted;
+        result.mMap.reserve(mKeys.size());
+
+        for (size_t i = 0; i != mKeys.size(); i++)
+        {
+            auto &value = result.mMap.emplace_back(mKeys[i]).value();
+            auto &col = mColumns[i];
+
+            if (!col.is_null(idx))
+                value.construct_as_string(col.scalar(idx));
+        }
+
+        return result;
+    }
+
+    yaml table::to_yaml() const
+    {
+        yaml result{value_t::sequence};
+        result.mSequence.reserve(rows());
+
+        for (size_t i = 0; i != rows(); i++)
+            result.mSequence.emplace_back(row(i));
+
+        return result;
+    }
+
+} // namespace ulib
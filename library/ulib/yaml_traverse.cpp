@@ -0,0 +1,130 @@
+#include "yaml.h"
+#include "yaml_detail.h"
+
+#include <type_traits>
+
+namespace ulib
+{
+    using value_t = typename yaml::value_t;
+
+    namespace
+    {
+        // siblings ahead of the child being entered whose contents are prefetched
+        constexpr size_t kPrefetchAhead = 4;
+        constexpr size_t kMaxPasses = 64;
+    } // namespace
+
+    template <class NodeT, class PassT>
+    void yaml::traverse_passes(NodeT &root, PassT *const *passes, size_t count)
+    {
+        if (count > kMaxPasses)
+            throw value_error{ulib::string{"[yaml.value_error] ulib::yaml.traverse(): at most 64 passes, got "} +
+                              std::to_string(count)};
+
+        if (count == 0)
+            return;
+
+        using ItemPtrT = std::conditional_t<std::is_const_v<NodeT>, const ItemT, ItemT> *;
+
+        // a node on the path from the root, with the passes that entered it and the ones walking its children
+        struct frame
+        {
+            NodeT *node;
+            visit_info at;
+            uint64_t entered;
+            uint64_t descend;
+            ItemPtrT items;
+            NodeT *values;
+            size_t size;
+            size_t next;
+        };
+
+        // the heap block a node's reads start at, so that it is in cache when the walk gets there
+        auto prefetch_contents = [](const yaml &node) {
+            if (node.mIndirect)
+                yaml_detail::prefetch(node.mNode);
+            else if (node.mType == value_t::map)
+                yaml_detail::prefetch(node.mMap.data());
+            else if (node.mType == value_t::sequence)
+                yaml_detail::prefetch(node.mSequence.data());
+            else if (node.mType == value_t::scalar)
+                yaml_detail::prefetch(node.mScalar.data());
+        };
+
+        ulib::List<frame> stack;
+        auto push = [&](NodeT *node, const visit_info &at, uint64_t mask) {
+            frame f{node, at, mask, 0, nullptr, nullptr, 0, 0};
+            for (size_t i = 0; i != count; i++)
+                if ((mask >> i & 1) && passes[i]->enter(*node, at))
+                    f.descend |= uint64_t(1) << i;
+
+            if (f.descend)
+            {
+                // read after enter(), which may have replaced the node
+                NodeT *self = node;
+                if constexpr (std::is_const_v<NodeT>)
+                    self = &node->resolved();
+                else
+                    node->detach();
+
+                if (self->mType == value_t::map)
+                    f.items = self->mMap.data(), f.size = self->mMap.size();
+                else if (self->mType == value_t::sequence)
+                    f.values = self->mSequence.data(), f.size = self->mSequence.size();
+
+                for (size_t i = 0; i != f.size && i != kPrefetchAhead; i++)
+                    prefetch_contents(f.items ? f.items[i].value() : f.values[i]);
+            }
+
+            stack.push_back(f);
+        };
+
+        push(&root, visit_info{}, count == kMaxPasses ? ~uint64_t(0) : (uint64_t(1) << count) - 1);
+        while (!stack.empty())
+        {
+            frame &top = stack.back();
+            if (top.next != top.size)
+            {
+                size_t i = top.next++;
+                if (i + kPrefetchAhead < top.size)
+                    prefetch_contents(top.items ? top.items[i + kPrefetchAhead].value()
+                                                : top.values[i + kPrefetchAhead]);
+
+                NodeT *child = top.items ? &top.items[i].value() : &top.values[i];
+                visit_info at{top.items ? &top.items[i] : nullptr, i, top.at.depth + 1};
+
+                // invalidates top
+                push(child, at, top.descend);
+                continue;
+            }
+
+            for (size_t i = 0; i != count; i++)
+                if (top.entered >> i & 1)
+                    passes[i]->leave(*top.node, top.at);
+
+            stack.pop_back();
+        }
+    }
+
+    void yaml::traverse(visitor &pass) const
+    {
+        visitor *passes[] = {&pass};
+        traverse_passes(*this, passes, 1);
+    }
+
+    void yaml::traverse(std::initializer_list<visitor *> passes) const
+    {
+        traverse_passes(*this, passes.begin(), passes.size());
+    }
+
+    void yaml::traverse(transformer &pass)
+    {
+        transformer *passes[] = {&pass};
+        traverse_passes(*this, passes, 1);
+    }
+
+    void yaml::traverse(std::initializer_list<transformer *> passes)
+    {
+        traverse_passes(*this, passes.begin(), passes.size());
+    }
+} // namespace ulib
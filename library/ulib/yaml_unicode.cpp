@@ -0,0 +1,370 @@
+#include "yaml.h"
+#include "yaml_detail.h"
+
+#include <cstring>
+#include <string>
+
+namespace ulib
+{
+    using StringViewT = typename yaml::StringViewT;
+    using StringT = typename yaml::StringT;
+
+    namespace yaml_detail
+    {
+        int utf8_sequence(const char *it, const char *end)
+        {
+            auto at = [&](ptrdiff_t i) { return uint8_t(it[i]); };
+
+            uint8_t lead = at(0);
+            if (lead < 0x80)
+                return 1;
+
+            // C0, C1 and F5..FF never start a sequence, E0/ED/F0/F4 narrow the second byte so that overlong
+            // forms, surrogates and code points past U+10FFFF are rejected
+            int size;
+            uint8_t low = 0x80, high = 0xBF;
+            if (lead >= 0xC2 && lead <= 0xDF)
+                size = 2;
+            else if (lead >= 0xE0 && lead <= 0xEF)
+            {
+                size = 3;
+                if (lead == 0xE0)
+                    low = 0xA0;
+                else if (lead == 0xED)
+                    high = 0x9F;
+            }
+            else if (lead >= 0xF0 && lead <= 0xF4)
+            {
+                size = 4;
+                if (lead == 0xF0)
+                    low = 0x90;
+                else if (lead == 0xF4)
+                    high = 0x8F;
+            }
+            else
+                return 0;
+
+            for (int i = 1; i != size; i++)
+            {
+                if (it + i == end)
+                    return -1;
+
+                uint8_t c = at(i);
+                if (c < low || c > high)
+                    return 0;
+
+                low = 0x80, high = 0xBF;
+            }
+
+            return size;
+        }
+
+        size_t validate_utf8(const char *data, size_t size, size_t &complete)
+        {
+            constexpr uint64_t kHigh = 0x8080808080808080ull;
+
+            const char *it = data;
+            const char *end = data + size;
+            for (;;)
+            {
+                // runs of ASCII 8 bytes at a time
+                while (end - it >= 8)
+                {
+                    uint64_t v;
+                    std::memcpy(&v, it, 8);
+                    if (v & kHigh)
+                        break;
+
+                    it += 8;
+                }
+
+                while (it != end && uint8_t(*it) < 0x80)
+                    it++;
+
+                if (it == end)
+                    break;
+
+                int n = utf8_sequence(it, end);
+                if (n == 0)
+                {
+                    complete = size_t(it - data);
+                    return complete;
+                }
+
+                if (n < 0)
+                {
+                    complete = size_t(it - data);
+                    return size;
+                }
+
+                it += n;
+            }
+
+            complete = size;
+            return size;
+        }
+
+        void require_utf8(StringViewT str, const char *fn)
+        {
+            size_t complete;
+            size_t invalid = validate_utf8(str.data(), str.size(), complete);
+            if (invalid != str.size() || complete != str.size())
+                throw yaml::parse_error{ulib::string{"[yaml.parse_error] ulib::yaml::"} + fn +
+                                        "(): invalid UTF-8 at byte " + std::to_string(complete)};
+        }
+
+        input_encoding detect_encoding(const char *data, size_t size, size_t &bom)
+        {
+            auto at = [&](size_t i) { return i < size ? int(uint8_t(data[i])) : -1; };
+
+            // byte order marks, then the null bytes around an ASCII first character, as the YAML spec describes
+            bom = 0;
+            if (at(0) == 0 && at(1) == 0 && at(2) == 0xFE && at(3) == 0xFF)
+                return bom = 4, input_encoding::utf32be;
+            if (at(0) == 0xFF && at(1) == 0xFE && at(2) == 0 && at(3) == 0)
+                return bom = 4, input_encoding::utf32le;
+            if (at(0) == 0xFE && at(1) == 0xFF)
+                return bom = 2, input_encoding::utf16be;
+            if (at(0) == 0xFF && at(1) == 0xFE)
+                return bom = 2, input_encoding::utf16le;
+            if (at(0) == 0xEF && at(1) == 0xBB && at(2) == 0xBF)
+                return bom = 3, input_encoding::utf8;
+
+            if (size >= 4 && at(0) == 0 && at(1) == 0 && at(2) == 0 && at(3) != 0)
+                return input_encoding::utf32be;
+            if (size >= 4 && at(0) != 0 && at(1) == 0 && at(2) == 0 && at(3) == 0)
+                return input_encoding::utf32le;
+            if (size >= 2 && at(0) == 0 && at(1) != 0)
+                return input_encoding::utf16be;
+            if (size >= 2 && at(0) != 0 && at(1) == 0)
+                return input_encoding::utf16le;
+
+            return input_encoding::utf8;
+        }
+
+        const char *encoding_name(input_encoding encoding)
+        {
+            switch (encoding)
+            {
+            case input_encoding::utf16le: return "UTF-16LE";
+            case input_encoding::utf16be: return "UTF-16BE";
+            case input_encoding::utf32le: return "UTF-32LE";
+            case input_encoding::utf32be: return "UTF-32BE";
+            default: return "UTF-8";
+            }
+        }
+
+        bool transcode_to_utf8(input_encoding encoding, const char *data, size_t size, std::string &out,
+                               size_t &error)
+        {
+            auto bytes = (const uint8_t *)data;
+            bool wide = encoding == input_encoding::utf32le || encoding == input_encoding::utf32be;
+            bool big = encoding == input_encoding::utf16be || encoding == input_encoding::utf32be;
+            size_t unit = wide ? 4 : 2;
+
+            // trailing null bytes are padding, as for UTF-8 input
+            while (size % unit != 0 && bytes[size - 1] == 0)
+                size--;
+            if (size % unit != 0)
+            {
+                error = size - size % unit;
+                return false;
+            }
+
+            auto load = [&](size_t i) -> uint32_t {
+                const uint8_t *p = bytes + i;
+                if (wide)
+                    return big ? uint32_t(p[0]) << 24 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 8 | p[3]
+                               : uint32_t(p[3]) << 24 | uint32_t(p[2]) << 16 | uint32_t(p[1]) << 8 | p[0];
+                return big ? uint32_t(p[0]) << 8 | p[1] : uint32_t(p[1]) << 8 | p[0];
+            };
+
+            out.clear();
+            out.reserve(size / unit + size / 8);
+
+            size_t i = 0;
+            while (i != size)
+            {
+                // ASCII in blocks of 4 units: every high byte zero and no low byte past 0x7F. the block is
+                // branch free, so the compiler can keep it in vector registers
+                while (size - i >= 4 * unit)
+                {
+                    uint32_t any = 0;
+                    char block[4];
+                    for (size_t k = 0; k != 4; k++)
+                    {
+                        uint32_t v = load(i + k * unit);
+                        any |= v;
+                        block[k] = char(v);
+                    }
+
+                    if (any >= 0x80)
+                        break;
+
+                    out.append(block, 4);
+                    i += 4 * unit;
+                }
+
+                if (i == size)
+                    break;
+
+                uint32_t cp = load(i);
+                size_t at = i;
+                i += unit;
+
+                if (!wide && cp >= 0xD800 && cp <= 0xDBFF)
+                {
+                    uint32_t low = i != size ? load(i) : 0;
+                    if (low < 0xDC00 || low > 0xDFFF)
+                    {
+                        error = at;
+                        return false;
+                    }
+
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    i += unit;
+                }
+                else if ((cp >= 0xD800 && cp <= 0xDFFF) || cp > 0x10FFFF)
+                {
+                    error = at;
+                    return false;
+                }
+
+                append_utf8(out, cp);
+            }
+
+            while (!out.empty() && out.back() == 0)
+                out.pop_back();
+
+            return true;
+        }
+
+        bool decode_quoted(const char *begin, const char *end, StringT &out)
+        {
+            char quote = *begin;
+            const char *it = begin + 1;
+            const char *last = end - 1;
+            if (end - begin < 2 || *last != quote)
+                return false;
+
+            auto hex = [&](size_t digits, uint32_t &value) {
+                if (size_t(last - it) < digits)
+                    return false;
+
+                value = 0;
+                for (size_t i = 0; i != digits; i++)
+                {
+                    char c = it[i];
+                    uint32_t digit;
+                    if (c >= '0' && c <= '9')
+                        digit = c - '0';
+                    else if (c >= 'a' && c <= 'f')
+                        digit = c - 'a' + 10;
+                    else if (c >= 'A' && c <= 'F')
+                        digit = c - 'A' + 10;
+                    else
+                        return false;
+
+                    value = value << 4 | digit;
+                }
+
+                it += digits;
+                return true;
+            };
+
+            out.clear();
+            while (it != last)
+            {
+                const char *run = it;
+                while (it != last && *it != quote && *it != '\\' && *it != '\n' && *it != '\r')
+                    it++;
+                out += StringViewT{run, size_t(it - run)};
+
+                if (it == last)
+                    break;
+
+                // line folding is left to the parser
+                if (*it == '\n' || *it == '\r')
+                    return false;
+
+                if (quote == '\'')
+                {
+                    if (*it == '\\')
+                    {
+                        out.push_back('\\');
+                        it++;
+                        continue;
+                    }
+
+                    if (last - it < 2 || it[1] != '\'')
+                        return false;
+
+                    out.push_back('\'');
+                    it += 2;
+                    continue;
+                }
+
+                if (*it == '"' || ++it == last)
+                    return false;
+
+                uint32_t cp;
+                switch (*it++)
+                {
+                case '0': out.push_back('\0'); break;
+                case 'a': out.push_back('\a'); break;
+                case 'b': out.push_back('\b'); break;
+                case 't': case '\t': out.push_back('\t'); break;
+                case 'n': out.push_back('\n'); break;
+                case 'v': out.push_back('\v'); break;
+                case 'f': out.push_back('\f'); break;
+                case 'r': out.push_back('\r'); break;
+                case 'e': out.push_back('\x1B'); break;
+                case ' ': out.push_back(' '); break;
+                case '"': out.push_back('"'); break;
+                case '/': out.push_back('/'); break;
+                case '\\': out.push_back('\\'); break;
+                case 'N': append_utf8(out, 0x85); break;
+                case '_': append_utf8(out, 0xA0); break;
+                case 'L': append_utf8(out, 0x2028); break;
+                case 'P': append_utf8(out, 0x2029); break;
+                case 'x':
+                    if (!hex(2, cp))
+                        return false;
+                    append_utf8(out, cp);
+                    break;
+                case 'u':
+                    if (!hex(4, cp) || (cp >= 0xD800 && cp <= 0xDFFF))
+                        return false;
+                    append_utf8(out, cp);
+                    break;
+                case 'U':
+                    if (!hex(8, cp) || (cp >= 0xD800 && cp <= 0xDFFF) || cp > 0x10FFFF)
+                        return false;
+                    append_utf8(out, cp);
+                    break;
+                default:
+                    return false;
+                }
+            }
+
+            return true;
+        }
+    } // namespace yaml_detail
+
+    yaml::conversion &yaml::conversion_slot(const void *type, StringViewT str)
+    {
+        thread_local conversion slots[64];
+
+        uint64_t hash = KeyT::hash_of(str) ^ uint64_t(uintptr_t(type));
+        conversion &slot = slots[hash % 64];
+        if (slot.type != type || slot.source.size() != str.size() ||
+            std::memcmp(slot.source.data(), str.data(), str.size()) != 0)
+        {
+            slot.type = type;
+            slot.source.assign(str.data(), str.size());
+            slot.value.reset();
+        }
+
+        return slot;
+    }
+} // namespace ulib
@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+#include <ulib/yaml.h>
+
+#include <string>
+#include <string_view>
+
+static const char *kDocument = R"(
+base: &base
+  image: app
+  env: {a: 1, b: 2}
+one: *base
+two: *base
+list:
+  - &item x
+  - *item
+)";
+
+TEST(YamlAnchors, AliasesShareTheAnchoredSubtree)
+{
+    ulib::yaml yml = ulib::yaml::parse(kDocument);
+    const ulib::yaml &cyml = yml;
+
+    ASSERT_NE(cyml["base"].shared_id(), nullptr);
+    ASSERT_EQ(cyml["base"].shared_id(), cyml["one"].shared_id());
+    ASSERT_EQ(cyml["two"]["env"]["b"].get<int>(), 2);
+    ASSERT_EQ(cyml["list"][1].get<ulib::string>(), "x");
+    ASSERT_EQ(cyml["base"].anchor_name(), "base");
+
+    // writing through one alias doesn't change the others
+    yml["one"]["image"] = "other";
+    ASSERT_EQ(cyml["one"].shared_id(), nullptr);
+    ASSERT_EQ(cyml["two"]["image"].get<ulib::string>(), "app");
+    ASSERT_EQ(cyml["base"]["image"].get<ulib::string>(), "app");
+}
+
+TEST(YamlAnchors, DumpKeepsAnchors)
+{
+    ulib::yaml yml = ulib::yaml::parse(kDocument);
+    ulib::string text = yml.dump();
+    std::string_view view{text.data(), text.size()};
+
+    ASSERT_NE(view.find("&base"), std::string_view::npos);
+    ASSERT_NE(view.find("*base"), std::string_view::npos);
+
+    ulib::yaml reparsed = ulib::yaml::parse(text);
+    ASSERT_TRUE(reparsed == yml);
+    ASSERT_EQ(reparsed["one"].shared_id(), reparsed["two"].shared_id());
+
+    ulib::yaml loaded = ulib::yaml::load_binary(yml.dump_binary());
+    ASSERT_TRUE(loaded == yml);
+    ASSERT_EQ(loaded["one"].shared_id(), loaded["two"].shared_id());
+}
+
+TEST(YamlAnchors, ExpansionLimit)
+{
+    // ten levels of ten references each
+    std::string bomb = "a: &a [x, x, x, x, x, x, x, x, x, x]\n";
+    for (char c = 'b'; c != 'k'; c++)
+    {
+        std::string prev{char(c - 1)};
+        bomb += std::string{c} + ": &" + c + " [*" + prev;
+        for (int i = 1; i != 10; i++)
+            bomb += ", *" + prev;
+        bomb += "]\n";
+    }
+
+    ASSERT_THROW(ulib::yaml::parse(bomb), ulib::yaml::parse_error);
+
+    ulib::yaml::parse_options options;
+    options.max_alias_expansion = 0;
+    ASSERT_EQ(ulib::yaml::parse(bomb, options)["j"][0][0][0][0].size(), 10);
+}
+
+TEST(YamlAnchors, NullKeys)
+{
+    // read as the key "null", as the yaml-cpp node conversion did
+    ulib::yaml doc = ulib::yaml::parse("null: 1\n~: 2\nb: 3\n");
+    ASSERT_EQ(doc.items().size(), 2);
+    ASSERT_EQ(doc["null"].get<int>(), 2);
+    ASSERT_EQ(doc["b"].get<int>(), 3);
+
+    ASSERT_EQ(ulib::yaml::parse("~: 1\nb: 2\n")["null"].get<int>(), 1);
+    ASSERT_EQ(ulib::yaml::parse("? &k\n: v\nw: *k\n")["null"].scalar(), "v");
+}
@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+#include <ulib/yaml.h>
+
+#include <vector>
+
+TEST(YamlBinary, RoundTrip)
+{
+    ulib::yaml yml = ulib::yaml::parse("name: a\nitems:\n  - {name: b, id: 1}\n  - {name: c, id: 2}\n  - ~\nempty: ''");
+
+    for (bool intern : {true, false})
+    {
+        auto image = yml.dump_binary(intern);
+        ulib::yaml loaded = ulib::yaml::load_binary(image);
+
+        ASSERT_TRUE(loaded == yml);
+        ASSERT_EQ(loaded.dump(), yml.dump());
+    }
+}
+
+TEST(YamlBinary, RejectsCorruptedImage)
+{
+    auto image = ulib::yaml::parse("a: [1, 2, 3]").dump_binary();
+
+    auto corrupted = image;
+    corrupted[corrupted.size() - 1] ^= 0xFF;
+    ASSERT_THROW(ulib::yaml::load_binary(corrupted), ulib::yaml::parse_error);
+
+    ASSERT_THROW(ulib::yaml::load_binary(image.data(), image.size() - 1), ulib::yaml::parse_error);
+    ASSERT_THROW(ulib::yaml::load_binary("a: 1", 4), ulib::yaml::parse_error);
+}
+
+TEST(YamlBinary, RejectsDeepNesting)
+{
+    // images with a valid checksum around the payload
+    auto load = [](const std::vector<uint8_t> &payload) {
+        uint64_t hash = 0xcbf29ce484222325;
+        for (uint8_t b : payload)
+            hash = (hash ^ b) * 0x100000001b3;
+
+        auto header = ulib::yaml{}.dump_binary(false);
+        std::vector<uint8_t> image(header.begin(), header.begin() + 8);
+        for (uint64_t v : {uint64_t(payload.size()), hash})
+            for (size_t i = 0; i != 8; i++)
+                image.push_back(uint8_t(v >> (i * 8)));
+        image.insert(image.end(), payload.begin(), payload.end());
+        return ulib::yaml::load_binary(image.data(), image.size());
+    };
+
+    // single-item sequences nested past max_depth
+    std::vector<uint8_t> payload;
+    for (size_t i = 0; i != ulib::yaml::max_depth + 1; i++)
+        payload.insert(payload.end(), {2, 1});
+    payload.push_back(0);
+    ASSERT_THROW(load(payload), ulib::yaml::parse_error);
+
+    // a chain of anchors, which don't add a level
+    std::vector<uint8_t> anchors(1000000, 4);
+    anchors.push_back(0);
+    ASSERT_THROW(load(anchors), ulib::yaml::parse_error);
+    ASSERT_THROW(load({4, 5, 0}), ulib::yaml::parse_error);
+    ASSERT_TRUE(load({4, 0}).is_null());
+
+    // the writer refuses what the reader would reject
+    ulib::yaml deep = ulib::yaml::sequence();
+    ulib::yaml *node = &deep;
+    for (size_t i = 0; i != ulib::yaml::max_depth; i++)
+        node = &node->push_back();
+    ASSERT_EQ(ulib::yaml::load_binary(deep.dump_binary()), deep);
+
+    node->push_back();
+    ASSERT_THROW(deep.dump_binary(), ulib::yaml::value_error);
+}
@@ -0,0 +1,32 @@
+#include <gtest/gtest.h>
+#include <ulib/yaml.h>
+
+#include <filesystem>
+#include <fstream>
+
+TEST(YamlCache, ParseFileCached)
+{
+    namespace fs = std::filesystem;
+
+    fs::path dir = fs::temp_directory_path() / "ulib-yaml-cache-test";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+
+    fs::path source = dir / "config.yml";
+    std::ofstream{source} << "a: 1\nb: [x, y]\n";
+
+    ulib::string path = source.string();
+    ulib::string cache = (dir / "cache").string();
+
+    ulib::yaml first = ulib::yaml::parse_file_cached(path, cache);
+    ASSERT_FALSE(fs::is_empty(dir / "cache"));
+
+    ulib::yaml second = ulib::yaml::parse_file_cached(path, cache);
+    ASSERT_TRUE(first == second);
+    ASSERT_TRUE(first == ulib::yaml::parse_file(path));
+
+    std::ofstream{source} << "a: 2\n";
+    ASSERT_EQ(ulib::yaml::parse_file_cached(path, cache)["a"].get<int>(), 2);
+
+    fs::remove_all(dir);
+}
@@ -0,0 +1,37 @@
+#include <gtest/gtest.h>
+#include <ulib/yaml.h>
+
+TEST(YamlCompare, Equal)
+{
+    ulib::yaml a = ulib::yaml::parse("a: 1\nb: [x, y]\nc: {d: null}");
+    ulib::yaml b = ulib::yaml::parse("a: 1\nb: [x, y]\nc: {d: null}");
+
+    ASSERT_TRUE(a == b);
+    ASSERT_EQ(a.compare(b), 0);
+
+    b["b"][1] = "z";
+    ASSERT_TRUE(a != b);
+    ASSERT_LT(a.compare(b), 0);
+}
+
+TEST(YamlCompare, MapOrder)
+{
+    ulib::yaml a = ulib::yaml::parse("a: 1\nb: 2\nc: {x: 1, y: 2}");
+    ulib::yaml b = ulib::yaml::parse("a: 1\nc: {y: 2, x: 1}\nb: 2");
+
+    ASSERT_FALSE(a == b);
+    ASSERT_TRUE(a.equal(b, true));
+
+    b["c"]["x"] = 3;
+    ASSERT_FALSE(a.equal(b, true));
+}
+
+TEST(YamlCompare, TypeMismatch)
+{
+    ulib::yaml a = ulib::yaml::parse("[1]");
+    ulib::yaml b = ulib::yaml::parse("{a: 1}");
+
+    ASSERT_FALSE(a == b);
+    ASSERT_LT(a.compare(b), 0);
+    ASSERT_GT(b.compare(a), 0);
+}
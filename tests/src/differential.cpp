@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+
+#include "../../fuzz/differential.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+
+// every parse path against the yaml-cpp reference on generated and mutated documents, with the time each path
+// takes per class of input. ULIB_YAML_FUZZ_ITERATIONS and ULIB_YAML_FUZZ_SEED widen the run, ULIB_YAML_FUZZ_REPORT=1
+// prints the throughput of each path
+TEST(YamlDifferential, GeneratedAndMutated)
+{
+    auto env = [](const char *name, uint64_t fallback) {
+        const char *value = std::getenv(name);
+        return value ? std::strtoull(value, nullptr, 0) : fallback;
+    };
+
+    uint64_t iterations = env("ULIB_YAML_FUZZ_ITERATIONS", 400);
+    yaml_fuzz::generator gen{env("ULIB_YAML_FUZZ_SEED", 0x5eed)};
+
+    struct input_class
+    {
+        const char *name;
+        std::function<std::string()> make;
+        yaml_fuzz::timings times;
+    };
+
+    input_class classes[] = {
+        {"block", [&] { return gen.block(); }, {}},
+        {"flow", [&] { return gen.flow(); }, {}},
+        {"json", [&] { return gen.json(); }, {}},
+        {"records", [&] { return gen.records(); }, {}},
+        {"mutated block", [&] { return gen.mutate(gen.block()); }, {}},
+        {"mutated json", [&] { return gen.mutate(gen.json()); }, {}},
+    };
+
+    size_t failures = 0;
+    for (auto &cls : classes)
+    {
+        for (uint64_t i = 0; i != iterations && failures < 5; i++)
+        {
+            std::string text = cls.make();
+            std::string diff = yaml_fuzz::check(text, &cls.times, i);
+            if (!diff.empty())
+            {
+                failures++;
+                ADD_FAILURE() << cls.name << ": " << diff << "\n--- input:\n" << text << "\n---";
+            }
+        }
+    }
+
+    if (!env("ULIB_YAML_FUZZ_REPORT", 0))
+        return;
+
+    std::printf("%-14s", "MB/s");
+    for (size_t path = 0; path != size_t(yaml_fuzz::path_t::count); path++)
+        std::printf("%12s", yaml_fuzz::path_name(yaml_fuzz::path_t(path)));
+    std::printf("\n");
+
+    for (auto &cls : classes)
+    {
+        std::printf("%-14s", cls.name);
+        for (double seconds : cls.times.seconds)
+            std::printf("%12.1f", seconds > 0 ? cls.times.bytes / seconds / 1e6 : 0.0);
+        std::printf("\n");
+    }
+}
@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+#include <ulib/yaml.h>
+
+#include <string>
+#include <unordered_map>
+
+TEST(YamlHandles, SurviveSiblingInsertions)
+{
+    ulib::yaml doc = ulib::yaml::parse("hosts:\n  - name: a\n    nics: [1, 2]\n  - name: b\nport: 80\n");
+    ulib::yaml::handle_pool pool{doc};
+
+    auto hosts = pool.child(pool.root(), "hosts");
+    auto second = pool.child(hosts, size_t(1));
+    auto name = pool.child(second, "name");
+    auto port = pool.child(pool.root(), "port");
+    ASSERT_TRUE(name && port);
+    ASSERT_EQ(pool.child(second, "name"), name);
+    ASSERT_EQ(pool.parent(name), second);
+    ASSERT_FALSE(pool.child(second, "missing"));
+
+    // external index keyed by id
+    std::unordered_map<uint64_t, std::string> index;
+    index[name.id()] = "b";
+
+    // enough inserts to reallocate every container on the path
+    for (int i = 0; i != 100; i++)
+    {
+        doc["key" + std::to_string(i)] = i;
+        doc["hosts"].push_back(ulib::yaml::map());
+        doc["hosts"][1]["extra" + std::to_string(i)] = i;
+    }
+
+    ASSERT_EQ(pool.get(name)->get<ulib::string>(), index[name.id()]);
+    ASSERT_EQ(pool.get(port)->get<int>(), 80);
+
+    // moved by a removal in front of it, then gone, also after the key is set again
+    doc.remove("hosts");
+    ASSERT_EQ(pool.get(port)->get<int>(), 80);
+    doc["hosts"] = ulib::yaml::parse("[{name: x}, {name: y}]");
+    ASSERT_EQ(pool.get(name), nullptr);
+    ASSERT_EQ(pool.get(hosts), nullptr);
+
+    // the new item gets a new handle
+    auto fresh = pool.child(pool.root(), "hosts");
+    ASSERT_NE(fresh, hosts);
+    ASSERT_FALSE(pool.valid(hosts));
+    hosts = fresh;
+
+    second = pool.child(hosts, size_t(1));
+    name = pool.child(second, "name");
+    ASSERT_EQ(pool.get(name)->get<ulib::string>(), "y");
+
+    const ulib::yaml::handle_pool &cpool = pool;
+    ASSERT_EQ(cpool.get(name)->get<ulib::string>(), "y");
+
+    // copies of a released handle stop resolving, its children don't
+    auto copy = second;
+    pool.release(second);
+    ASSERT_FALSE(pool.valid(copy));
+    ASSERT_EQ(pool.get(copy), nullptr);
+    ASSERT_EQ(pool.get(name)->get<ulib::string>(), "y");
+
+    size_t held = pool.size();
+    pool.release(name);
+    ASSERT_EQ(pool.size(), held - 2);
+
+    auto again = pool.child(pool.child(hosts, size_t(1)), "name");
+    ASSERT_NE(again.id(), name.id());
+    ASSERT_EQ(pool.get(again)->get<ulib::string>(), "y");
+}
+
+TEST(YamlHandles, SortedAndSharedParents)
+{
+    ulib::yaml::parse_options options;
+    options.sorted_maps = true;
+
+    ulib::yaml doc = ulib::yaml::parse("base: &b {m: 1, z: 2}\nuse: *b\n", options);
+    ulib::yaml::handle_pool pool{doc};
+
+    // reading doesn't detach the alias from its anchor
+    const ulib::yaml &cdoc = doc;
+    const ulib::yaml::handle_pool &cpool = pool;
+    auto use = pool.child(pool.root(), "use");
+    ASSERT_EQ((*cpool.get(use))["z"].get<int>(), 2);
+    ASSERT_EQ(cdoc["use"].shared_id(), cdoc["base"].shared_id());
+
+    auto z = pool.child(use, "z");
+    ASSERT_EQ(pool.get(z)->get<int>(), 2);
+
+    // a key sorted in front moves the item, writes through the handle don't reach the anchor
+    doc["use"]["a"] = 0;
+    *pool.get(z) = 5;
+    ASSERT_EQ(doc["use"]["z"].get<int>(), 5);
+    ASSERT_EQ(doc["base"]["z"].get<int>(), 2);
+}
+
+TEST(YamlHandles, SharedKeyPool)
+{
+    // items of documents parsed with one pool share their key buffers
+    ulib::yaml::key_pool keys;
+    ulib::yaml doc = ulib::yaml::parse("hosts: [a, b]\nport: 80\n", keys);
+    ulib::yaml::handle_pool pool{doc};
+
+    auto hosts = pool.child(pool.root(), "hosts");
+    auto first = pool.child(hosts, size_t(0));
+    auto port = pool.child(pool.root(), "port");
+    ASSERT_EQ(pool.get(first)->get<ulib::string>(), "a");
+
+    // re-keying and assigning keep the item
+    doc.compact(keys);
+    doc["port"] = 81;
+    ASSERT_EQ(pool.get(port)->get<int>(), 81);
+    ASSERT_EQ(pool.get(first)->get<ulib::string>(), "a");
+
+    // the same key buffer on a new item
+    doc.remove("hosts");
+    doc.emplace(keys.intern("hosts"), ulib::yaml::parse("[c]", keys));
+    ASSERT_EQ(pool.get(hosts), nullptr);
+    ASSERT_EQ(pool.get(first), nullptr);
+
+    auto fresh = pool.child(pool.root(), "hosts");
+    ASSERT_NE(fresh, hosts);
+    ASSERT_EQ(pool.get(pool.child(fresh, size_t(0)))->get<ulib::string>(), "c");
+
+    // items inserted from another document, and copies of a named item, are other items too
+    const ulib::yaml other = ulib::yaml::parse("port: 90\n", keys);
+    doc.remove("port");
+    doc.insert_range(other.items());
+    ASSERT_EQ(pool.get(port), nullptr);
+
+    port = pool.child(pool.root(), "port");
+    ulib::yaml copy = doc;
+    doc = copy;
+    ASSERT_EQ(pool.get(port), nullptr);
+    ASSERT_EQ(pool.get(pool.child(pool.root(), "port"))->get<int>(), 90);
+}
@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+#include <ulib/yaml.h>
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace
+{
+    namespace fs = std::filesystem;
+
+    void write_file(const fs::path &path, const std::string &text)
+    {
+        std::ofstream out{path, std::ios::binary | std::ios::trunc};
+        out << text;
+    }
+
+    void set_env(const char *name, const char *value)
+    {
+#ifdef _WIN32
+        _putenv_s(name, value);
+#else
+        setenv(name, value, 1);
+#endif
+    }
+} // namespace
+
+TEST(YamlInclude, SharedFragments)
+{
+    fs::path dir = fs::temp_directory_path() / "ulib_yaml_include";
+    fs::remove_all(dir);
+    fs::create_directories(dir / "parts");
+
+    write_file(dir / "root.yaml",
+               "a: !include parts/common.yaml\nb: !include parts/common.yaml\nc: !include parts/b.yaml\n");
+    write_file(dir / "parts" / "common.yaml", "x: 1\ny: [1, 2]\n");
+    write_file(dir / "parts" / "b.yaml", "nested: !include common.yaml\n");
+
+    ulib::yaml::include_resolver resolver;
+    ulib::yaml::parse_options options;
+    options.includes = &resolver;
+
+    std::string root = (dir / "root.yaml").string();
+    const ulib::yaml yml = ulib::yaml::parse_file(root, options);
+    ASSERT_EQ(yml["a"]["x"].get<int>(), 1);
+    ASSERT_EQ(yml["b"]["y"][1].get<int>(), 2);
+    ASSERT_EQ(yml["c"]["nested"]["x"].get<int>(), 1);
+    ASSERT_EQ(resolver.parsed(), 2);
+
+    // each include is written out where it is, not as an anchor and aliases
+    ASSERT_EQ(yml.dump(), "a:\n x: 1\n y:\n  - 1\n  - 2\n"
+                          "b:\n x: 1\n y:\n  - 1\n  - 2\n"
+                          "c:\n nested:\n  x: 1\n  y:\n   - 1\n   - 2");
+    ASSERT_EQ(ulib::yaml::load_binary(yml.dump_binary()).dump(), yml.dump());
+
+    // cached fragments are reused, a changed one is parsed again along with the files including it
+    ulib::yaml again = ulib::yaml::parse_file(root, options);
+    ASSERT_EQ(resolver.parsed(), 2);
+    ASSERT_EQ(again, yml);
+
+    write_file(dir / "parts" / "common.yaml", "x: 22\n");
+    fs::last_write_time(dir / "parts" / "common.yaml",
+                        fs::last_write_time(dir / "root.yaml") + std::chrono::seconds(5));
+
+    const ulib::yaml changed = ulib::yaml::parse_file(root, options);
+    ASSERT_EQ(changed["a"]["x"].get<int>(), 22);
+    ASSERT_EQ(changed["c"]["nested"]["x"].get<int>(), 22);
+    ASSERT_EQ(resolver.parsed(), 4);
+
+    // the earlier document keeps its fragments
+    ASSERT_EQ(yml["a"]["x"].get<int>(), 1);
+
+    // a modification of the included subtree stays local
+    again["a"]["x"] = ulib::yaml{ulib::string{"5"}};
+    ASSERT_EQ(yml["b"]["x"].get<int>(), 1);
+
+    fs::remove_all(dir);
+}
+
+TEST(YamlInclude, Cycles)
+{
+    fs::path dir = fs::temp_directory_path() / "ulib_yaml_include_cycle";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+
+    write_file(dir / "a.yaml", "next: !include b.yaml\n");
+    write_file(dir / "b.yaml", "next: !include a.yaml\n");
+
+    ulib::yaml::include_resolver resolver;
+    ulib::yaml::parse_options options;
+    options.includes = &resolver;
+
+    ASSERT_THROW(ulib::yaml::parse_file((dir / "a.yaml").string(), options), ulib::yaml::parse_error);
+    ASSERT_THROW(ulib::yaml::parse_file((dir / "missing.yaml").string(), options), ulib::yaml::exception);
+
+    fs::remove_all(dir);
+}
+
+TEST(YamlInclude, Environment)
+{
+    set_env("ULIB_YAML_TEST_HOST", "example.org");
+
+    ulib::yaml::parse_options options;
+    options.expand_env = true;
+
+    const ulib::yaml yml = ulib::yaml::parse(
+        "url: \"https://${ULIB_YAML_TEST_HOST}/x\"\nport: ${ULIB_YAML_TEST_UNSET:-8080}\nraw: $${HOME} $5\n", options);
+    ASSERT_EQ(yml["url"].get<ulib::string>(), "https://example.org/x");
+    ASSERT_EQ(yml["port"].get<int>(), 8080);
+    ASSERT_EQ(yml["raw"].get<ulib::string>(), "${HOME} $5");
+
+    ASSERT_THROW(ulib::yaml::parse("a: ${ULIB_YAML_TEST_UNSET}", options), ulib::yaml::parse_error);
+
+    // left alone without the option
+    ASSERT_EQ(ulib::yaml::parse("a: ${ULIB_YAML_TEST_HOST}")["a"].get<ulib::string>(), "${ULIB_YAML_TEST_HOST}");
+}
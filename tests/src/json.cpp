@@ -0,0 +1,54 @@
+#include <gtest/gtest.h>
+#include <ulib/yaml.h>
+
+#include <string>
+
+TEST(YamlJson, ParsesJson)
+{
+    ulib::yaml yml = ulib::yaml::parse_json(R"( {"a": 1, "b": [true, false, null, -0.5e+3], )"
+                                            R"("c": {"d": "x\"\\\/\n\u00e9\ud83d\ude00"}, "e": [], "f": {}} )");
+    const ulib::yaml &cyml = yml;
+
+    ASSERT_EQ(cyml["a"].get<int>(), 1);
+    ASSERT_EQ(cyml["b"][0].scalar(), "true");
+    ASSERT_TRUE(cyml["b"][2].is_null());
+    ASSERT_EQ(cyml["b"][3].scalar(), "-0.5e+3");
+    ASSERT_EQ(cyml["c"]["d"].scalar(), "x\"\\/\n\xC3\xA9\xF0\x9F\x98\x80");
+    ASSERT_EQ(cyml["e"].size(), 0);
+    ASSERT_TRUE(cyml["f"].is_map());
+
+    // the same document through the YAML parser
+    ASSERT_TRUE(yml == ulib::yaml::parse(yml.dump()));
+}
+
+TEST(YamlJson, ParseDetectsJson)
+{
+    std::string text = "[";
+    for (int i = 0; i != 100; i++)
+        text += "{\"id\": " + std::to_string(i) + ", \"name\": \"n" + std::to_string(i) + "\"},";
+    text.back() = ']';
+
+    ulib::yaml::parse_options options;
+    options.columnar = true;
+
+    ulib::yaml yml = ulib::yaml::parse(ulib::string{text}, options);
+    ASSERT_NE(yml.as_table(), nullptr);
+    ASSERT_EQ(yml.size(), 100);
+
+    // flow style YAML that isn't JSON falls back to the YAML parser
+    ulib::yaml flow = ulib::yaml::parse("{a: 1, b: [x, y]}");
+    ASSERT_EQ(flow["b"][1].get<ulib::string>(), "y");
+
+    std::string deep(100000, '[');
+    deep += std::string(100000, ']');
+    ASSERT_EQ(ulib::yaml::parse_json(ulib::string{deep}).size(), 1);
+}
+
+TEST(YamlJson, RejectsInvalidJson)
+{
+    const char *invalid[] = {"", "{", "[1,]", "{\"a\" 1}", "01", "\"a\nb\"", "\"\\x\"", "\"\\ud800\"", "[1] 2",
+                             "tru", "{a: 1}"};
+
+    for (auto text : invalid)
+        ASSERT_THROW(ulib::yaml::parse_json(text), ulib::yaml::parse_error) << text;
+}
@@ -0,0 +1,31 @@
+#include <gtest/gtest.h>
+#include <ulib/yaml.h>
+
+TEST(YamlKeys, InternedKeysShareStorage)
+{
+    ulib::yaml::key_pool pool;
+    ulib::yaml yml = ulib::yaml::parse("- {id: 1, name: a}\n- {id: 2, name: b}\n- {name: c, id: 3}", pool);
+
+    ASSERT_EQ(pool.size(), 2);
+
+    auto first = yml[0].items();
+    auto last = yml[2].items();
+    ASSERT_TRUE(first[0].key().same(last[1].key()));
+    ASSERT_EQ(yml[2]["id"].get<int>(), 3);
+}
+
+TEST(YamlKeys, Lookup)
+{
+    ulib::yaml yml;
+    yml["alpha"] = 1;
+    yml["beta"] = 2;
+    yml[""] = 3;
+
+    ASSERT_EQ(yml.at("beta").get<int>(), 2);
+    ASSERT_EQ(yml.at("").get<int>(), 3);
+    ASSERT_EQ(yml.search("gamma"), nullptr);
+
+    yml.remove("alpha");
+    ASSERT_EQ(yml.items().size(), 2);
+    ASSERT_EQ(yml.items()[0].name(), "beta");
+}
@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+#include <ulib/yaml.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+static ulib::yaml parse_lazy(const char *text)
+{
+    ulib::yaml::parse_options options;
+    options.lazy = true;
+    return ulib::yaml::parse(text, options);
+}
+
+TEST(YamlLazy, MatchesEagerParse)
+{
+    const char *documents[] = {
+        "%YAML 1.2\n--- # doc\na: 1\n\"q: k\": {x: [1, 2]}\nb:\n  - c\n  - |\n    text\nd: 'it''s'\na: 2\n",
+        "- 1\n- a: b\n-\n  - nested\n",
+        "base: &b {x: 1}\nuse: *b\n",
+        "{\"json\": [1, 2]}",
+        "? complex\n: key\n",
+        "scalar",
+    };
+
+    for (auto text : documents)
+    {
+        SCOPED_TRACE(text);
+        ASSERT_TRUE(parse_lazy(text) == ulib::yaml::parse(text));
+    }
+}
+
+TEST(YamlLazy, ValuesAreParsedOnAccess)
+{
+    ulib::yaml yml = parse_lazy("a: 1\nb: }\nc: [3]\n");
+    const ulib::yaml &cyml = yml;
+
+    ASSERT_EQ(cyml.items().size(), 3);
+    ASSERT_EQ(cyml["a"].get<int>(), 1);
+    ASSERT_EQ(cyml["c"][0].get<int>(), 3);
+    ASSERT_ANY_THROW(cyml["b"].type());
+
+    // a value is parsed once even if many threads reach it at the same time
+    std::string big = "big:\n";
+    for (int i = 0; i != 1000; i++)
+        big += "  k" + std::to_string(i) + ": " + std::to_string(i) + "\n";
+    big += "small: 1\n";
+
+    ulib::yaml shared = parse_lazy(big.c_str());
+    const ulib::yaml &cshared = shared;
+
+    std::vector<std::thread> threads;
+    std::vector<int> results(8);
+    for (int i = 0; i != 8; i++)
+        threads.emplace_back([&, i]() { results[i] = cshared["big"]["k999"].get<int>(); });
+    for (auto &thread : threads)
+        thread.join();
+
+    for (int result : results)
+        ASSERT_EQ(result, 999);
+
+    shared["small"] = 2;
+    ASSERT_EQ(cshared["small"].get<int>(), 2);
+}
+
+TEST(YamlLazy, ParseFile)
+{
+    auto path = std::filesystem::temp_directory_path() / "ulib_yaml_lazy_test.yml";
+    {
+        std::ofstream out{path};
+        out << "first: {a: 1}\nsecond: [x, y]\n";
+    }
+
+    ulib::yaml::parse_options options;
+    options.lazy = true;
+
+    ulib::yaml yml = ulib::yaml::parse_file(ulib::string{path.string()}, options);
+
+    // rewritten in place, then truncated: the unparsed values keep the text that was read
+    {
+        std::fstream out{path, std::ios::in | std::ios::out};
+        out << "first: {a: 9}\nsecond: [z, z]\n";
+    }
+    std::filesystem::resize_file(path, 0);
+    std::filesystem::remove(path);
+
+    const ulib::yaml &cyml = yml;
+    ASSERT_EQ(cyml["second"][1].get<ulib::string>(), "y");
+    ASSERT_EQ(cyml["first"]["a"].get<int>(), 1);
+}
@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+#include <ulib/yaml.h>
+
+#include <string>
+
+TEST(YamlMemory, UsageAndCompact)
+{
+    // built item by item: grown containers and a key buffer per item
+    ulib::yaml doc = ulib::yaml::map();
+    for (int i = 0; i != 100; i++)
+    {
+        ulib::yaml &host = doc["hosts"].push_back();
+        host["name"] = "host-with-a-long-enough-name-" + std::to_string(i);
+        host["port"] = 8000 + i;
+        for (int j = 0; j != 5; j++)
+            host["tags"].push_back("t" + std::to_string(j));
+    }
+
+    ulib::yaml::memory_stats before = doc.memory_usage();
+    ASSERT_EQ(before.node_count, 1 + 1 + 100 * (1 + 3 + 5));
+    ASSERT_GT(before.slack, 0);
+    ASSERT_GE(before.scalars, 100 * 30);
+    ASSERT_EQ(before.retained, 0);
+    ASSERT_EQ(before.total(), before.nodes + before.keys + before.scalars + before.slack);
+
+    ulib::yaml copy = doc;
+    doc.compact();
+    ASSERT_EQ(doc, copy);
+
+    ulib::yaml::memory_stats after = doc.memory_usage();
+    ASSERT_EQ(after.node_count, before.node_count);
+    ASSERT_EQ(after.nodes, before.nodes);
+    ASSERT_EQ(after.slack, 0);
+    ASSERT_LT(after.keys, before.keys);
+    ASSERT_LT(after.total(), before.total());
+
+    // keys shared through a pool with other documents
+    ulib::yaml::key_pool pool;
+    ulib::yaml other = ulib::yaml::parse("name: x\nport: 1\n", pool);
+    doc.compact(pool);
+    ASSERT_TRUE(doc["hosts"][0].items()[0].key().same(other.items()[0].key()));
+}
+
+TEST(YamlMemory, SharedSubtrees)
+{
+    ulib::yaml doc = ulib::yaml::parse("base: &b [a-long-scalar-value-that-is-stored-outside, 2, 3]\n"
+                                       "x: *b\ny: *b\n");
+
+    // the anchored subtree counts once
+    ulib::yaml::memory_stats stats = doc.memory_usage();
+    ulib::yaml alone = ulib::yaml::parse("base: [a-long-scalar-value-that-is-stored-outside, 2, 3]\n");
+    ASSERT_EQ(stats.scalars, alone.memory_usage().scalars);
+    ASSERT_EQ(stats.node_count, alone.memory_usage().node_count);
+
+    // referenced only from inside the document: compacted. a copy outside keeps it as it is
+    const ulib::yaml &cdoc = doc;
+    ulib::yaml outside = cdoc["x"];
+    doc.compact();
+    ASSERT_EQ(cdoc["y"][0].get<ulib::string>(), "a-long-scalar-value-that-is-stored-outside");
+    ASSERT_EQ(cdoc["y"].shared_id(), outside.shared_id());
+
+    // lazy values aren't built by the walk
+    ulib::yaml::parse_options lazy;
+    lazy.lazy = true;
+    ulib::yaml deferred = ulib::yaml::parse("a: [1, 2]\nb: {c: 3}\n", lazy);
+    ASSERT_EQ(deferred.memory_usage().node_count, 1);
+}
+
+TEST(YamlMemory, RetainedStorage)
+{
+    // unparsed lazy entries keep their text, a parsed one doesn't
+    ulib::yaml::parse_options lazy;
+    lazy.lazy = true;
+    ulib::string text = "a: [1, 2]\nb: {c: 3}\n";
+    ulib::yaml deferred = ulib::yaml::parse(text, lazy);
+    ASSERT_EQ(deferred.memory_usage().retained, text.size());
+
+    const ulib::yaml &cdeferred = deferred;
+    ASSERT_EQ(cdeferred["a"][1].get<int>(), 2);
+    ASSERT_EQ(deferred.memory_usage().retained, ulib::string{"b: {c: 3}\n"}.size());
+
+    // columns count without building rows, built rows count as nodes on top
+    ulib::string records;
+    for (int i = 0; i != 100; i++)
+        records += "- {id: " + std::to_string(i) + ", name: name-of-record-" + std::to_string(i) + "}\n";
+
+    ulib::yaml::parse_options columnar;
+    columnar.columnar = true;
+    ulib::yaml table = ulib::yaml::parse(records, columnar);
+    ASSERT_NE(table.as_table(), nullptr);
+
+    ulib::yaml::memory_stats stats = table.memory_usage();
+    ASSERT_GE(stats.retained, 100 * 18);
+    ASSERT_EQ(stats.node_count, 0);
+    ASSERT_GT(stats.keys, 0);
+
+    const ulib::yaml &ctable = table;
+    ASSERT_EQ(ctable[7]["id"].get<int>(), 7);
+    ulib::yaml::memory_stats read = table.memory_usage();
+    ASSERT_EQ(read.retained, stats.retained);
+    ASSERT_GT(read.node_count, 0);
+    ASSERT_EQ(read.keys, stats.keys);
+}
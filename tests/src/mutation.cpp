@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+#include <ulib/yaml.h>
+
+#include <string>
+
+TEST(YamlMutation, BulkInserts)
+{
+    ulib::yaml yml = ulib::yaml::map();
+    yml.reserve(1000);
+    for (int i = 0; i != 1000; i++)
+        yml.emplace(ulib::string{"k" + std::to_string(i)}, ulib::yaml{ulib::string{std::to_string(i)}});
+
+    const ulib::yaml &cyml = yml;
+    ASSERT_EQ(cyml.items().size(), 1000);
+    ASSERT_EQ(cyml["k999"].get<int>(), 999);
+
+    ulib::yaml::MapT batch;
+    batch.emplace_back(ulib::yaml::KeyT{"k1"}, ulib::yaml{ulib::string{"one"}});
+    batch.emplace_back(ulib::yaml::KeyT{"new"}, ulib::yaml{ulib::string{"x"}});
+    batch.emplace_back(ulib::yaml::KeyT{"new"}, ulib::yaml{ulib::string{"y"}});
+
+    ulib::yaml copy = yml;
+    copy.insert_range(batch);
+    yml.insert_range(std::move(batch));
+
+    for (auto *doc : {&yml, &copy})
+    {
+        const ulib::yaml &cdoc = *doc;
+        ASSERT_EQ(cdoc.items().size(), 1001);
+        ASSERT_EQ(cdoc["k1"].get<ulib::string>(), "one");
+        ASSERT_EQ(cdoc["new"].get<ulib::string>(), "y");
+    }
+
+    ulib::yaml seq = ulib::yaml::sequence();
+    seq.reserve(4);
+    seq.push_back(ulib::yaml::parse("{a: 1}"));
+
+    ulib::yaml::SequenceT values;
+    values.push_back(ulib::yaml{ulib::string{"v"}});
+    seq.insert_range(std::move(values));
+
+    ulib::yaml tail = ulib::yaml::parse("[x, y]");
+    const ulib::yaml &ctail = tail;
+    seq.insert_range(ctail.values());
+
+    const ulib::yaml &cseq = seq;
+    ASSERT_EQ(cseq.size(), 4);
+    ASSERT_EQ(cseq[0]["a"].get<int>(), 1);
+    ASSERT_EQ(cseq[1].get<ulib::string>(), "v");
+    ASSERT_EQ(cseq[3].get<ulib::string>(), "y");
+
+    ulib::yaml scalar{ulib::string{"s"}};
+    ASSERT_THROW(scalar.reserve(1), ulib::yaml::value_error);
+
+    // a range out of the node itself
+    seq.insert_range(cseq.values());
+    ASSERT_EQ(cseq.size(), 8);
+    ASSERT_EQ(cseq[7].get<ulib::string>(), "y");
+    ASSERT_EQ(cseq[4]["a"].get<int>(), 1);
+
+    ulib::yaml self = ulib::yaml::parse("{a: [1, 2], b: x}");
+    const ulib::yaml &cself = self;
+    self.insert_range(cself.items());
+    ASSERT_EQ(self, ulib::yaml::parse("{a: [1, 2], b: x}"));
+}
@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+#include <ulib/yaml.h>
+
+#include <string>
+#include <vector>
+
+using list = std::vector<std::string>;
+
+static list scalars(const ulib::List<const ulib::yaml *> &nodes)
+{
+    list result;
+    for (const ulib::yaml *node : nodes)
+        result.emplace_back(node->scalar().data(), node->scalar().size());
+    return result;
+}
+
+static list names(const ulib::List<const ulib::yaml *> &nodes)
+{
+    list result;
+    for (const ulib::yaml *node : nodes)
+        result.emplace_back((*node)["name"].scalar().data(), (*node)["name"].scalar().size());
+    return result;
+}
+
+static std::vector<const ulib::yaml *> pointers(const ulib::List<const ulib::yaml *> &nodes)
+{
+    return std::vector<const ulib::yaml *>(nodes.begin(), nodes.end());
+}
+
+TEST(YamlQuery, PathsAndSelectors)
+{
+    const ulib::yaml doc = ulib::yaml::parse("hosts:\n"
+                                             "  - name: a\n"
+                                             "    nics: [{speed: 10000}, {speed: 40000}]\n"
+                                             "  - name: b\n"
+                                             "    nics: [{speed: 25000}]\n"
+                                             "  - name: c\n"
+                                             "list: [0, 1, 2, 3, 4, 5]\n"
+                                             "'odd key': x\n");
+
+    // results point into the document
+    auto hosts = doc.select("$.hosts[*]");
+    ASSERT_EQ(hosts.size(), 3);
+    ASSERT_EQ(hosts[1], &doc["hosts"][1]);
+
+    ASSERT_EQ(names(doc.select(".hosts[*]")), (list{"a", "b", "c"}));
+    ASSERT_EQ(names(doc.select("hosts[-1]")), (list{"c"}));
+    ASSERT_EQ(scalars(doc.select("$..name")), (list{"a", "b", "c"}));
+    ASSERT_EQ(scalars(doc.select("$.hosts..speed")), (list{"10000", "40000", "25000"}));
+    ASSERT_EQ(scalars(doc.select("$['odd key']")), (list{"x"}));
+    ASSERT_EQ(scalars(doc.select("$.hosts[0,2].name")), (list{"a", "c"}));
+    ASSERT_EQ(doc.select("$.hosts[0]['name','nics']").size(), 2);
+
+    // slices
+    ASSERT_EQ(scalars(doc.select("$.list[1:3]")), (list{"1", "2"}));
+    ASSERT_EQ(scalars(doc.select("$.list[::2]")), (list{"0", "2", "4"}));
+    ASSERT_EQ(scalars(doc.select("$.list[-2:]")), (list{"4", "5"}));
+    ASSERT_EQ(scalars(doc.select("$.list[::-2]")), (list{"5", "3", "1"}));
+    ASSERT_EQ(scalars(doc.select("$.list[4:1:-1]")), (list{"4", "3", "2"}));
+    ASSERT_EQ(doc.select("$.list[::0]").size(), 0);
+
+    // misses select nothing
+    ASSERT_EQ(doc.select("$.missing.name").size(), 0);
+    ASSERT_EQ(doc.select("$.list.name").size(), 0);
+    ASSERT_EQ(doc.select("$.list[6]").size(), 0);
+    ASSERT_EQ(doc.select("$").size(), 1);
+
+    for (const char *bad : {"$.", "$[", "$[1", "$['a]", "$[?(@.a ==)]", "$[?(1)]", "$[a]", "$.a b"})
+    {
+        SCOPED_TRACE(bad);
+        ASSERT_THROW(ulib::yaml::query{bad}, ulib::yaml::parse_error);
+    }
+}
+
+TEST(YamlQuery, Filters)
+{
+    const ulib::yaml doc = ulib::yaml::parse("hosts:\n"
+                                             "  - name: a\n"
+                                             "    up: true\n"
+                                             "    nics: [{speed: 10000}, {speed: 40000}]\n"
+                                             "  - name: b\n"
+                                             "    up: no\n"
+                                             "    nics: [{speed: 25000, vendor: acme}]\n"
+                                             "  - name: c\n"
+                                             "    owner: ~\n"
+                                             "limit: 20000\n");
+
+    const ulib::yaml::query fast{"$.hosts[*].nics[?(@.speed >= 25000)]"};
+    ASSERT_EQ(fast.select(doc).size(), 2);
+    ASSERT_EQ(fast.first(doc), &doc["hosts"][0]["nics"][1]);
+
+    ASSERT_EQ(names(doc.select("$.hosts[?(@.up == true)]")), (list{"a"}));
+    ASSERT_EQ(names(doc.select("$.hosts[?(@.up != true)]")), (list{"b", "c"}));
+    ASSERT_EQ(names(doc.select("$.hosts[?(@.owner == null)]")), (list{"c"}));
+    ASSERT_EQ(names(doc.select("$.hosts[?(@.name > 'a')]")), (list{"b", "c"}));
+    ASSERT_EQ(names(doc.select("$.hosts[?(!@.nics)]")), (list{"c"}));
+    ASSERT_EQ(names(doc.select("$.hosts[?@.nics[?(@.vendor)]]")), (list{"b"}));
+    ASSERT_EQ(names(doc.select("$.hosts[?(@.nics[0].speed < $.limit)]")), (list{"a"}));
+    ASSERT_EQ(names(doc.select("$.hosts[?(25000 <= @.nics[0].speed || @.name == 'a')]")), (list{"a", "b"}));
+    ASSERT_EQ(names(doc.select("$.hosts[?(@.up == true && (@.name == 'b' || @.nics[1]))]")), (list{"a"}));
+    ASSERT_EQ(scalars(doc.select("$..[?(@.speed > 10000)].speed")), (list{"40000", "25000"}));
+
+    // not a number: neither ordered nor equal
+    ASSERT_EQ(doc.select("$.hosts[?(@.name < 5)]").size(), 0);
+    ASSERT_EQ(doc.select("$.hosts[?(@.name != 5)]").size(), 3);
+}
+
+TEST(YamlQuery, ParallelAndTables)
+{
+    ulib::string text;
+    for (int i = 0; i != 20000; i++)
+        text += "- {id: " + std::to_string(i) + ", speed: " + std::to_string(i % 7 * 10000) + "}\n";
+
+    ulib::yaml plain = ulib::yaml::parse(text);
+    ulib::yaml::parse_options columnar;
+    columnar.columnar = true;
+    ulib::yaml table = ulib::yaml::parse(text, columnar);
+    ASSERT_NE(table.as_table(), nullptr);
+
+    const ulib::yaml::query query{"$[?(@.speed >= 40000)].id"};
+    auto expected = query.select(plain);
+    ASSERT_EQ(expected.size(), 20000 / 7 * 3);
+
+    // split between threads: the same nodes in the same order
+    ASSERT_EQ(pointers(query.select(plain, 4)), pointers(expected));
+    ASSERT_EQ(scalars(query.select(plain, 0)), scalars(expected));
+
+    // a typed column is scanned instead of the rows
+    ASSERT_EQ(scalars(query.select(table, 4)), scalars(expected));
+    ASSERT_EQ(ulib::yaml::query{"$[?(40000 > @.speed)]"}.select(table).size(), 20000 - expected.size());
+    ASSERT_EQ(ulib::yaml::query{"$[?(@.speed == 0 && @.id < 10)]"}.select(table, 4).size(), 2);
+
+    // the scan builds no rows, a match is a row that is built on its first read
+    ulib::yaml fresh = ulib::yaml::parse(text, columnar);
+    ASSERT_TRUE(fresh.select("$[?(@.id > 20000)]").empty());
+    ASSERT_EQ(fresh.memory_usage().node_count, 0);
+
+    auto match = fresh.select("$[?(@.id == 5)]");
+    ASSERT_EQ(match.size(), 1);
+    ASSERT_EQ(fresh.memory_usage().node_count, 1);
+    ASSERT_EQ((*match[0])["speed"].get<int>(), 50000);
+}
@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+#include <ulib/yaml.h>
+#include <ulib/yaml_schema.h>
+
+static const char *kSchema = R"(
+type: object
+required: [name, hosts]
+additionalProperties: false
+properties:
+  name: {type: string, minLength: 1}
+  hosts:
+    type: array
+    minItems: 1
+    items:
+      type: object
+      required: [addr]
+      properties:
+        addr: {type: string}
+        port: {type: integer, minimum: 1, maximum: 65535}
+        role: {enum: [primary, replica]}
+)";
+
+TEST(YamlSchema, Valid)
+{
+    auto schema = ulib::yaml_schema::parse(kSchema);
+    auto doc = ulib::yaml::parse("name: db\nhosts:\n  - {addr: a, port: 5432, role: primary}\n  - {addr: b}");
+
+    ASSERT_TRUE(schema.valid(doc));
+    ASSERT_EQ(schema.validate(doc).size(), 0);
+}
+
+TEST(YamlSchema, ReportsAllViolations)
+{
+    auto schema = ulib::yaml_schema::parse(kSchema);
+    auto doc = ulib::yaml::parse("hosts:\n  - {port: 70000, role: other}\n  - {addr: [x]}\nextra: 1");
+
+    ASSERT_FALSE(schema.valid(doc));
+
+    auto violations = schema.validate(doc);
+    ASSERT_EQ(violations.size(), 6);
+
+    auto has = [&](const char *path) {
+        for (auto &v : violations)
+            if (v.path == path)
+                return true;
+        return false;
+    };
+
+    ASSERT_TRUE(has("$"));
+    ASSERT_TRUE(has("$.extra"));
+    ASSERT_TRUE(has("$.hosts[0]"));
+    ASSERT_TRUE(has("$.hosts[0].port"));
+    ASSERT_TRUE(has("$.hosts[0].role"));
+    ASSERT_TRUE(has("$.hosts[1].addr"));
+}
+
+TEST(YamlSchema, InvalidSchema)
+{
+    ASSERT_THROW(ulib::yaml_schema::parse("type: text"), ulib::yaml_schema::schema_error);
+    ASSERT_THROW(ulib::yaml_schema::parse("minimum: abc"), ulib::yaml_schema::schema_error);
+}
+
+TEST(YamlSchema, NumberBounds)
+{
+    auto schema = ulib::yaml_schema::parse("{type: number, minimum: -1e2, maximum: 0.3}");
+
+    // read as the nearest double, not a scaled mantissa
+    for (const char *value : {"0.3", "3e-1", "30E-2", "-1e+2", "-100", "0.1e1"})
+        ASSERT_EQ(schema.valid(ulib::yaml{value}), std::string{value} != "0.1e1") << value;
+
+    ASSERT_FALSE(schema.valid(ulib::yaml{"-1e400"}));
+    ASSERT_TRUE(schema.valid(ulib::yaml{"1e-400"}));
+    ASSERT_FALSE(schema.valid(ulib::yaml{"0.3x"}));
+}
@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+#include <ulib/yaml.h>
+
+#include <string>
+
+TEST(YamlSorted, SortKeys)
+{
+    ulib::yaml yml = ulib::yaml::parse("b: 1\na: {z: 1, y: 2}\nc: [{q: 1, p: 2}]\n");
+    ASSERT_FALSE(yml.sorted());
+
+    yml.sort_keys(2);
+    ASSERT_TRUE(yml.sorted());
+
+    const ulib::yaml &cyml = yml;
+    ASSERT_EQ(cyml.items()[0].name(), "a");
+    ASSERT_EQ(cyml.items()[2].name(), "c");
+    ASSERT_EQ(cyml["a"].items()[0].name(), "y");
+    ASSERT_EQ(cyml["c"][0].items()[0].name(), "p");
+    ASSERT_EQ(cyml["b"].get<int>(), 1);
+
+    // new keys go in order
+    yml["bb"] = ulib::yaml{ulib::string{"x"}};
+    yml["0"] = ulib::yaml{ulib::string{"y"}};
+    yml.emplace(ulib::string{"b"}, ulib::yaml{ulib::string{"dup"}});
+    ASSERT_EQ(cyml.items()[0].name(), "0");
+    ASSERT_EQ(cyml.items()[2].name(), "b");
+    ASSERT_EQ(cyml.items()[3].get<ulib::string>(), "dup");
+    ASSERT_EQ(cyml.items()[4].name(), "bb");
+    ASSERT_EQ(cyml["b"].get<int>(), 1);
+
+    ulib::yaml::MapT batch;
+    batch.emplace_back(ulib::yaml::KeyT{"d"}, ulib::yaml{ulib::string{"1"}});
+    batch.emplace_back(ulib::yaml::KeyT{"ab"}, ulib::yaml{ulib::string{"2"}});
+    yml.insert_range(std::move(batch));
+
+    for (size_t i = 1; i != cyml.items().size(); i++)
+        ASSERT_LE(cyml.items()[i - 1].name(), cyml.items()[i].name());
+    ASSERT_EQ(cyml["ab"].get<int>(), 2);
+    ASSERT_EQ(cyml.search("missing"), nullptr);
+
+    // lookups agree with a linear scan
+    ulib::yaml big = ulib::yaml::map();
+    for (int i = 999; i >= 0; i--)
+        big[ulib::string{"k" + std::to_string(i)}] = ulib::yaml{ulib::string{std::to_string(i)}};
+    big.sort_keys(0);
+
+    const ulib::yaml &cbig = big;
+    for (int i = 0; i != 1000; i++)
+        ASSERT_EQ(cbig["k" + std::to_string(i)].get<int>(), i);
+}
+
+TEST(YamlSorted, ParseSortedMaps)
+{
+    ulib::yaml::parse_options options;
+    options.sorted_maps = true;
+
+    for (auto *text : {"b: 1\na: {d: 1, c: 2}\n", "{\"b\": 1, \"a\": {\"d\": 1, \"c\": 2}}"})
+    {
+        SCOPED_TRACE(text);
+        const ulib::yaml yml = ulib::yaml::parse(text, options);
+        ASSERT_TRUE(yml.sorted());
+        ASSERT_TRUE(yml["a"].sorted());
+        ASSERT_EQ(yml.items()[0].name(), "a");
+        ASSERT_EQ(yml["a"].items()[0].name(), "c");
+    }
+}
+
+TEST(YamlSorted, CanonicalDump)
+{
+    ulib::yaml::dump_options options;
+    options.canonical = true;
+
+    ulib::yaml::parse_options preserve;
+    preserve.preserve_style = true;
+
+    ulib::yaml left = ulib::yaml::parse("b: {y: \"1\", x: 2}\na: &s [1]\nc: *s\n", preserve);
+    ulib::yaml right = ulib::yaml::parse("a: [1]\nc: [1]\nb:\n  x: 2\n  y: 1\n");
+
+    ASSERT_EQ(left.dump(options), right.dump(options));
+    ASSERT_EQ(right.dump(options), "a:\n - 1\nb:\n x: 2\n y: 1\nc:\n - 1");
+
+    options.format = ulib::yaml::format_t::json;
+    ASSERT_EQ(left.dump(options), "{\"a\":[1],\"b\":{\"x\":2,\"y\":1},\"c\":[1]}");
+
+    // split across threads in key order
+    ulib::yaml big = ulib::yaml::map();
+    for (int i = 0; i != 200; i++)
+        big[ulib::string{"k" + std::to_string(199 - i)}] = ulib::yaml{ulib::string{std::to_string(i)}};
+
+    ulib::yaml sorted = big;
+    sorted.sort_keys();
+
+    options.format = ulib::yaml::format_t::block;
+    options.threads = 4;
+    options.parallel_min_nodes = 1;
+    ASSERT_EQ(big.dump(options), sorted.dump(ulib::yaml::dump_options{}));
+}
+
+TEST(YamlSorted, SortKeysKeepsSharedNodes)
+{
+    ulib::yaml yml = ulib::yaml::parse("base: &b {z: 1, y: [{q: 1, p: 2}]}\nx: *b\ny: *b\n");
+    const ulib::yaml &cyml = yml;
+    ulib::yaml outside = cyml["x"];
+
+    yml.sort_keys();
+    ASSERT_NE(cyml["x"].shared_id(), nullptr);
+    ASSERT_EQ(cyml["x"].shared_id(), cyml["y"].shared_id());
+    ASSERT_EQ(cyml["x"].shared_id(), cyml["base"].shared_id());
+    ASSERT_EQ(cyml["x"].items()[0].name(), "y");
+    ASSERT_EQ(cyml["x"]["y"][0].items()[0].name(), "p");
+    ASSERT_EQ(yml.dump(), "base: &b\n y:\n  -\n   p: 2\n   q: 1\n z: 1\nx: *b\ny: *b");
+
+    // references from other documents keep the original order
+    ASSERT_EQ(outside.items()[0].name(), "z");
+
+    // columns are reordered without building rows
+    ulib::string text;
+    for (int i = 0; i != 20; i++)
+        text += "- {id: " + std::to_string(i) + ", name: n, age: 1}\n";
+
+    ulib::yaml::parse_options columnar;
+    columnar.columnar = true;
+    ulib::yaml rows = ulib::yaml::parse("rows:\n" + text, columnar);
+    rows.sort_keys();
+
+    const ulib::yaml::table *table = rows["rows"].as_table();
+    ASSERT_NE(table, nullptr);
+    ASSERT_EQ(table->keys()[0].str(), "age");
+    ASSERT_EQ(table->keys()[2].str(), "name");
+
+    const ulib::yaml &crows = rows;
+    ASSERT_TRUE(crows["rows"][3].sorted());
+    ASSERT_EQ(crows["rows"][3].items()[1].name(), "id");
+    ASSERT_EQ(crows["rows"][3]["id"].get<int>(), 3);
+}
@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+#include <ulib/yaml.h>
+
+#include <string>
+
+static ulib::yaml feed_in_chunks(const std::string &text, size_t chunk)
+{
+    ulib::yaml::stream_parser parser;
+    for (size_t i = 0; i < text.size(); i += chunk)
+        parser.feed(ulib::string{text.substr(i, chunk)});
+
+    return parser.finish();
+}
+
+TEST(YamlStream, MatchesParse)
+{
+    const char *documents[] = {
+        "# comment\n---\na: 1\nb:\n  - x\n  - y\nc: |\n  text\n  more\n\nd: {e: 1}\n? f\n: g\n-1: h\n...\n",
+        "- 1\n- a: b\n  c: d\n-\n  - nested\n- \"quoted\n  line\"\n",
+        "a: \"multi\nline\"\nb: 2\n",
+        "a: [1,\n2]\nb: |\n  \"open\nc: !!str 'it''s\nd'\ne: 5\n",
+        "base: &b {x: 1}\nuse: *b\nmore: 3\n",
+        "items:\n- a\n- b\nother: 1\n",
+        "a: 1\n---\nb: 2\n",
+        "{\"a\": [1,\n2],\n\"b\": 3}",
+        "scalar",
+        "",
+    };
+
+    for (auto text : documents)
+    {
+        ulib::yaml expected = ulib::yaml::parse(text);
+        for (size_t chunk : {1, 2, 3, 7, 64})
+        {
+            SCOPED_TRACE(std::string{text} + " / " + std::to_string(chunk));
+            ASSERT_TRUE(feed_in_chunks(text, chunk) == expected);
+        }
+    }
+}
+
+TEST(YamlStream, EntriesAreAvailableEarly)
+{
+    ulib::yaml::stream_parser parser;
+    parser.feed("first: 1\nsecond:\n  - a\n");
+    ASSERT_EQ(parser.document().items().size(), 1);
+
+    parser.feed("  - b\nthird: 3\n");
+    ASSERT_EQ(parser.document().items().size(), 2);
+    ASSERT_EQ(parser.document()["second"].size(), 2);
+
+    ulib::yaml yml = parser.finish();
+    ASSERT_EQ(yml["third"].get<int>(), 3);
+    ASSERT_THROW(parser.feed("x"), ulib::yaml::exception);
+
+    ulib::yaml::stream_parser mixed;
+    mixed.feed("a: 1\n");
+    mixed.feed("- b\n- c\n");
+    ASSERT_ANY_THROW(mixed.finish());
+}
@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+#include <ulib/yaml.h>
+
+#include <string>
+#include <string_view>
+
+TEST(YamlStyle, ScalarsNeedingQuotesRoundTrip)
+{
+    const char *values[] = {"",      "null", "~",     "a: b",  "a #b",   "- x",  "-",      "[x]",
+                            "{x}",   "*x",   "&x",    " pad",  "pad ",   "---",  "a\nb",   "tab\there",
+                            "q\"uo", "b\\s", "x:",    "#",     "%p",     "@at",  "`tick", "'s",
+                            "x, y",  "a]b",  "a{b}",  "a:,b",  "a:]"};
+
+    ulib::yaml yml = ulib::yaml::map();
+    ulib::yaml seq = ulib::yaml::sequence();
+    for (auto value : values)
+    {
+        yml[value] = value;
+        seq.push_back(ulib::yaml{ulib::string{value}});
+    }
+    yml["list"] = seq;
+
+    ulib::yaml reparsed = ulib::yaml::parse(yml.dump());
+    ASSERT_TRUE(reparsed == yml);
+}
+
+TEST(YamlStyle, PlainScalarsStayPlain)
+{
+    ulib::yaml yml = ulib::yaml::parse("a: -1\nb: hello world\nc: http://x.org/a#b\nd: true");
+    ASSERT_EQ(yml.dump(), "a: -1\nb: hello world\nc: http://x.org/a#b\nd: true");
+
+    // flow indicators only need quotes inside flow collections
+    yml = ulib::yaml::parse("a: x, y\nb:\n - a[0]\n - v}");
+    ASSERT_EQ(yml.dump(), "a: x, y\nb:\n - a[0]\n - v}");
+    ASSERT_EQ(ulib::yaml{"x, y"}.dump(), "x, y");
+
+    ulib::yaml::dump_options flow;
+    flow.format = ulib::yaml::format_t::flow;
+    ASSERT_EQ(yml.dump(flow), "{a: \"x, y\", b: [\"a[0]\", \"v}\"]}");
+}
+
+TEST(YamlStyle, PreserveStyle)
+{
+    const char *text = "flow: {a: 1, b: [x, y]}\nblock:\n - 1\n - '2'\nempty: []";
+
+    ulib::yaml::parse_options options;
+    options.preserve_style = true;
+
+    ulib::yaml yml = ulib::yaml::parse(text, options);
+    const ulib::yaml &cyml = yml;
+    ASSERT_EQ(cyml["flow"].style(), ulib::yaml::style_t::flow);
+    ASSERT_EQ(cyml["block"][1].style(), ulib::yaml::style_t::quoted);
+    ASSERT_EQ(yml.dump(), "flow: {a: 1, b: [x, y]}\nblock:\n - 1\n - \"2\"\nempty: []");
+
+    // edits keep the style of the node they change
+    yml["block"][1] = "3";
+    ASSERT_EQ(yml.dump(), "flow: {a: 1, b: [x, y]}\nblock:\n - 1\n - \"3\"\nempty: []");
+
+    ASSERT_EQ(ulib::yaml::parse(text).dump(), "flow:\n a: 1\n b:\n  - x\n  - y\nblock:\n - 1\n - 2\nempty: []");
+}
+
+TEST(YamlStyle, DumpFormats)
+{
+    ulib::yaml yml = ulib::yaml::parse("a: 1\nb: [x, 'y z', \"q\\\"\"]\nc: {d: 1.5e3, e: true, f: 01}\ng: ~\nh: {}");
+
+    ulib::yaml::dump_options options;
+    options.format = ulib::yaml::format_t::flow;
+    ASSERT_EQ(yml.dump(options), "{a: 1, b: [x, y z, q\"], c: {d: 1.5e3, e: true, f: 01}, g: null, h: {}}");
+    ASSERT_TRUE(ulib::yaml::parse(yml.dump(options)) == yml);
+
+    options.format = ulib::yaml::format_t::json;
+    ASSERT_EQ(yml.dump(options),
+              "{\"a\":1,\"b\":[\"x\",\"y z\",\"q\\\"\"],\"c\":{\"d\":1.5e3,\"e\":true,\"f\":\"01\"},"
+              "\"g\":null,\"h\":{}}");
+
+    options.format = ulib::yaml::format_t::block;
+    options.indent = 2;
+    ASSERT_EQ(yml.dump(options),
+              "a: 1\nb:\n  - x\n  - y z\n  - q\"\nc:\n  d: 1.5e3\n  e: true\n  f: 01\ng: null\nh: {}");
+
+    options.flow_threshold = 3;
+    ASSERT_EQ(yml.dump(options), "a: 1\nb: [x, y z, q\"]\nc: {d: 1.5e3, e: true, f: 01}\ng: null\nh: {}");
+
+    options.indent = 0;
+    ASSERT_THROW(yml.dump(options), ulib::yaml::value_error);
+}
+
+TEST(YamlStyle, ParallelDumpMatchesSerial)
+{
+    ulib::yaml yml = ulib::yaml::parse("shared: &s {x: [1, 2]}\nlist: [a, b]");
+    for (int i = 0; i != 50; i++)
+    {
+        ulib::yaml entry = ulib::yaml::map();
+        entry["id"] = i;
+        entry["ref"] = yml["shared"];
+        entry["tags"] = ulib::yaml::parse("[x, \"y: z\", {k: v}]");
+        yml["entry" + std::to_string(i)] = entry;
+    }
+
+    ulib::yaml seq = ulib::yaml::sequence();
+    for (auto &itm : yml.items())
+        seq.push_back(itm.value());
+
+    for (auto format : {ulib::yaml::format_t::block, ulib::yaml::format_t::json})
+    {
+        for (auto &doc : {yml, seq})
+        {
+            ulib::yaml::dump_options options;
+            options.format = format;
+
+            ulib::string serial = doc.dump(options);
+            if (format == ulib::yaml::format_t::block)
+                ASSERT_NE(std::string_view(serial.data(), serial.size()).find("*s"), std::string_view::npos);
+
+            options.parallel_min_nodes = 0;
+            for (size_t threads : {2, 3, 8, 200})
+            {
+                options.threads = threads;
+                ASSERT_EQ(doc.dump(options), serial);
+            }
+        }
+    }
+}
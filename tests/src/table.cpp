@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include <ulib/yaml.h>
+
+static ulib::string make_records(size_t count)
+{
+    ulib::string text;
+    for (size_t i = 0; i != count; i++)
+        text += ulib::string{"- {id: "} + std::to_string(i) + ", name: n" + std::to_string(i) + ", speed: " +
+                std::to_string(i) + ".5, note: ~}\n";
+    return text;
+}
+
+TEST(YamlTable, ColumnarParse)
+{
+    ulib::string text = make_records(32);
+
+    ulib::yaml::parse_options options;
+    options.columnar = true;
+
+    ulib::yaml yml = ulib::yaml::parse(text, options);
+    auto table = yml.as_table();
+    ASSERT_NE(table, nullptr);
+    ASSERT_EQ(table->rows(), 32);
+    ASSERT_EQ(table->width(), 4);
+
+    auto id = table->find("id");
+    ASSERT_EQ(id->type(), ulib::yaml::table::column_t::integer);
+    ASSERT_EQ(id->integers()[31], 31);
+    ASSERT_EQ(table->find("speed")->type(), ulib::yaml::table::column_t::floating);
+    ASSERT_EQ(table->find("name")->type(), ulib::yaml::table::column_t::string);
+    ASSERT_TRUE(table->find("note")->is_null(3));
+
+    const ulib::yaml &cyml = yml;
+    ASSERT_EQ(cyml.size(), 32);
+    ASSERT_EQ(cyml[5]["name"].get<ulib::string>(), "n5");
+    ASSERT_TRUE(cyml[5]["note"].is_null());
+    ASSERT_TRUE(yml == ulib::yaml::parse(text));
+    ASSERT_EQ(yml.dump(), ulib::yaml::parse(text).dump());
+
+    // mutation detaches the node into a plain sequence
+    yml[0]["name"] = "changed";
+    ASSERT_EQ(yml.as_table(), nullptr);
+    ASSERT_EQ(yml[0]["name"].get<ulib::string>(), "changed");
+}
+
+TEST(YamlTable, HeterogeneousRecordsStayRegular)
+{
+    ulib::string text = make_records(20) + "- {id: 1, other: 2, speed: 1, note: x}\n";
+
+    ulib::yaml::parse_options options;
+    options.columnar = true;
+
+    ulib::yaml yml = ulib::yaml::parse(text, options);
+    ASSERT_EQ(yml.as_table(), nullptr);
+    ASSERT_FALSE(ulib::yaml::table::from(yml).has_value());
+    ASSERT_TRUE(ulib::yaml::table::from(ulib::yaml::parse(make_records(3))).has_value());
+}
+
+TEST(YamlTable, ColumnsFromEvents)
+{
+    ulib::string records = make_records(20);
+
+    ulib::yaml::parse_options options;
+    options.columnar = true;
+
+    // every way out of the column store gives the tree a plain parse builds
+    for (const ulib::string &text : {
+             records + "- {id: 1, name: [a, b], speed: 1, note: x}\n",
+             records + "- {id: 1, name: n, speed: {x: 1}, note: x}\n",
+             records + "- {id: 1, name: n}\n",
+             records + "- {id: 1, name: n, speed: 1, note: x, extra: y}\n",
+             records + "- {id: 1, name: &n n, speed: 1, note: x}\n",
+             records + "- &r {id: 1, name: n, speed: 1, note: x}\n- *r\n",
+             records + "- scalar\n",
+             records + "- [1, 2]\n",
+             ulib::string{"- {a: [1], b: 2}\n"} + records,
+             ulib::string{"- {a: 1, a: 2}\n"} + records,
+             ulib::string{"- {}\n"} + records,
+             make_records(3),
+         })
+    {
+        SCOPED_TRACE(text.c_str());
+        ulib::yaml plain = ulib::yaml::parse(text);
+        ulib::yaml yml = ulib::yaml::parse(text, options);
+        ASSERT_EQ(yml.as_table(), nullptr);
+        ASSERT_EQ(yml, plain);
+        ASSERT_EQ(yml.dump(), plain.dump());
+    }
+
+    // records without keys stay a sequence of empty maps on every path that builds tables
+    ulib::string empty = "[{}";
+    for (size_t i = 1; i != 20; i++)
+        empty += ", {}";
+    empty += "]";
+
+    ulib::string emptyBlock;
+    for (size_t i = 0; i != 20; i++)
+        emptyBlock += "- {}\n";
+
+    ulib::yaml::parse_options preserve = options;
+    preserve.preserve_style = true;
+    for (const ulib::yaml &yml : {ulib::yaml::parse_json(empty, options), ulib::yaml::parse(empty, options),
+                                  ulib::yaml::parse(emptyBlock, options), ulib::yaml::parse(emptyBlock, preserve)})
+    {
+        ASSERT_EQ(yml.as_table(), nullptr);
+        ASSERT_EQ(yml.size(), 20);
+        ASSERT_TRUE(yml == ulib::yaml::parse(emptyBlock));
+    }
+    ASSERT_FALSE(ulib::yaml::table::from(ulib::yaml::parse(emptyBlock)).has_value());
+
+    // a sequence inside one that fell back still gets columns
+    ulib::string inner;
+    for (size_t i = 0; i != 20; i++)
+        inner += "  - {id: " + std::to_string(i) + "}\n";
+
+    ulib::yaml nested = ulib::yaml::parse("- x\n-\n" + inner, options);
+    ASSERT_EQ(nested.as_table(), nullptr);
+    ASSERT_NE(nested[1].as_table(), nullptr);
+
+    // sorted maps: columns in key order
+    options.sorted_maps = true;
+    ulib::yaml sorted = ulib::yaml::parse(records, options);
+    ASSERT_NE(sorted.as_table(), nullptr);
+    ASSERT_EQ(sorted.as_table()->keys()[0].str(), "id");
+    ASSERT_EQ(sorted.as_table()->keys()[1].str(), "name");
+    ASSERT_EQ(sorted.as_table()->keys()[2].str(), "note");
+
+    ulib::yaml expected = ulib::yaml::parse(records);
+    expected.sort_keys();
+    ASSERT_EQ(sorted, expected);
+}
@@ -0,0 +1,167 @@
+#include <gtest/gtest.h>
+#include <ulib/yaml.h>
+
+#include <algorithm>
+#include <cctype>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // pre- and post-order events as "+path" and "-path"
+    struct recorder : ulib::yaml::visitor
+    {
+        bool enter(const ulib::yaml &node, const ulib::yaml::visit_info &at) override
+        {
+            events.push_back("+" + name(at));
+            return skip.empty() || name(at) != skip;
+        }
+
+        void leave(const ulib::yaml &node, const ulib::yaml::visit_info &at) override
+        {
+            events.push_back("-" + name(at));
+        }
+
+        static std::string name(const ulib::yaml::visit_info &at)
+        {
+            std::string result = std::to_string(at.depth) + ":";
+            if (at.item)
+                result.append(at.item->name().data(), at.item->name().size());
+            else
+                result += std::to_string(at.index);
+            return result;
+        }
+
+        std::string skip;
+        std::vector<std::string> events;
+    };
+
+    struct counter : ulib::yaml::visitor
+    {
+        bool enter(const ulib::yaml &node, const ulib::yaml::visit_info &at) override
+        {
+            nodes++;
+            depth = std::max(depth, at.depth);
+            if (node.is_scalar())
+                bytes += node.scalar().size();
+            return true;
+        }
+
+        size_t nodes = 0;
+        size_t depth = 0;
+        size_t bytes = 0;
+    };
+} // namespace
+
+TEST(YamlTraverse, PreAndPostOrder)
+{
+    const ulib::yaml doc = ulib::yaml::parse("a: [x, y]\nb: {c: z}\n");
+
+    recorder all;
+    doc.traverse(all);
+    ASSERT_EQ(all.events, (std::vector<std::string>{"+0:0", "+1:a", "+2:0", "-2:0", "+2:1", "-2:1", "-1:a", "+1:b",
+                                                    "+2:c", "-2:c", "-1:b", "-0:0"}));
+
+    // fused: a pass that skips a subtree doesn't change what the others see
+    recorder skipping;
+    skipping.skip = "1:a";
+    counter count;
+    doc.traverse({&skipping, &count});
+    ASSERT_EQ(skipping.events,
+              (std::vector<std::string>{"+0:0", "+1:a", "-1:a", "+1:b", "+2:c", "-2:c", "-1:b", "-0:0"}));
+    ASSERT_EQ(count.nodes, 6);
+    ASSERT_EQ(count.bytes, 3);
+}
+
+TEST(YamlTraverse, Transformers)
+{
+    ulib::yaml doc = ulib::yaml::parse("base: &b {name: x, tags: [p, q]}\nuse: *b\nplain: v\n");
+
+    // rewrites the scalars under "use", the anchored value stays as it was
+    struct upper : ulib::yaml::transformer
+    {
+        bool enter(ulib::yaml &node, const ulib::yaml::visit_info &at) override
+        {
+            if (at.depth == 1)
+                return at.item->name() == "use";
+
+            if (node.is_scalar())
+            {
+                ulib::string text{node.scalar()};
+                for (char &c : text)
+                    c = char(std::toupper(c));
+                node = text;
+            }
+            return true;
+        }
+    } pass;
+
+    // a node replaced in enter() has its new children walked
+    struct expand : ulib::yaml::transformer
+    {
+        bool enter(ulib::yaml &node, const ulib::yaml::visit_info &at) override
+        {
+            if (at.depth == 1 && at.item->name() == "plain")
+                node = ulib::yaml::parse("[a, b]");
+            else if (at.depth == 2 && node.is_scalar())
+                seen++;
+            return true;
+        }
+
+        size_t seen = 0;
+    } grow;
+
+    doc.traverse({&pass, &grow});
+    ASSERT_EQ(doc["use"]["name"].scalar(), "X");
+    ASSERT_EQ(doc["use"]["tags"][1].scalar(), "Q");
+    ASSERT_EQ(doc["base"]["tags"][1].scalar(), "q");
+    ASSERT_EQ(doc["plain"].size(), 2);
+    ASSERT_EQ(grow.seen, 4);
+}
+
+TEST(YamlTraverse, DeepDocuments)
+{
+    // deeper than a recursive walk gets on a default stack
+    constexpr size_t depth = 200000;
+
+    ulib::yaml doc = ulib::yaml::sequence();
+    ulib::yaml *node = &doc;
+    for (size_t i = 0; i != depth; i++)
+        node = &node->push_back();
+    *node = "leaf";
+
+    counter count;
+    doc.traverse(count);
+    ASSERT_EQ(count.nodes, depth + 1);
+    ASSERT_EQ(count.depth, depth);
+
+    // copied, compared and destroyed without recursion
+    ulib::yaml copy = doc;
+    ASSERT_TRUE(copy == doc);
+    ASSERT_EQ(copy.compare(doc), 0);
+
+    *node = "other";
+    ASSERT_FALSE(copy == doc);
+    ASSERT_GT(doc.compare(copy), 0);
+
+    ulib::yaml map = ulib::yaml::map();
+    ulib::yaml *item = &map;
+    for (size_t i = 0; i != depth; i++)
+        item = &(*item)["k"];
+    ASSERT_TRUE(map.equal(ulib::yaml{map}, true));
+
+    // writers recurse and stop at max_depth
+    ASSERT_THROW(doc.dump(), ulib::yaml::value_error);
+    ulib::yaml::dump_options json;
+    json.format = ulib::yaml::format_t::json;
+    ASSERT_THROW(doc.dump(json), ulib::yaml::value_error);
+    ASSERT_THROW(doc.dump_binary(), ulib::yaml::value_error);
+
+    ulib::yaml limit = ulib::yaml::sequence();
+    node = &limit;
+    for (size_t i = 0; i != ulib::yaml::max_depth; i++)
+        node = &node->push_back();
+    ASSERT_NO_THROW(limit.dump());
+    ASSERT_EQ(limit.dump(json), std::string(ulib::yaml::max_depth, '[') + "null" +
+                                    std::string(ulib::yaml::max_depth, ']'));
+}
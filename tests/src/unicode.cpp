@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+#include <ulib/yaml.h>
+
+#include <string>
+
+// code units of text in the given width and byte order, with a byte order mark if bom is set
+static std::string encode(const std::u32string &text, size_t width, bool big, bool bom)
+{
+    std::u32string units;
+    if (bom)
+        units.push_back(0xFEFF);
+
+    for (char32_t cp : text)
+    {
+        if (width == 2 && cp >= 0x10000)
+        {
+            units.push_back(0xD800 + ((cp - 0x10000) >> 10));
+            units.push_back(0xDC00 + ((cp - 0x10000) & 0x3FF));
+        }
+        else
+            units.push_back(cp);
+    }
+
+    std::string out;
+    for (char32_t unit : units)
+        for (size_t i = 0; i != width; i++)
+            out.push_back(char(unit >> (8 * (big ? width - 1 - i : i))));
+
+    return out;
+}
+
+TEST(YamlUnicode, DetectsEncodings)
+{
+    const std::u32string text = U"name: caf\u00e9\nlist: [1, \"\U0001F600\"]\nlong: the quick brown fox jumps\n";
+    const ulib::yaml expected = ulib::yaml::parse("name: caf\xC3\xA9\nlist: [1, \"\xF0\x9F\x98\x80\"]\n"
+                                                  "long: the quick brown fox jumps\n");
+
+    for (size_t width : {2, 4})
+    {
+        for (bool big : {false, true})
+        {
+            for (bool bom : {false, true})
+            {
+                SCOPED_TRACE(std::to_string(width) + (big ? " BE" : " LE") + (bom ? " BOM" : ""));
+                std::string bytes = encode(text, width, big, bom);
+
+                ASSERT_EQ(ulib::yaml::parse(ulib::string_view{bytes.data(), bytes.size()}), expected);
+
+                ulib::yaml::parse_options lazy;
+                lazy.lazy = true;
+                ASSERT_EQ(ulib::yaml::parse(ulib::string_view{bytes.data(), bytes.size()}, lazy), expected);
+            }
+        }
+    }
+
+    // a UTF-8 byte order mark is skipped, also before JSON
+    ASSERT_EQ(ulib::yaml::parse("\xEF\xBB\xBF{\"a\": 1}")["a"].get<int>(), 1);
+
+    // an unpaired surrogate
+    std::string broken = encode(U"a: x", 2, false, true) + std::string{"\x00\xD8", 2};
+    ASSERT_THROW(ulib::yaml::parse(ulib::string_view{broken.data(), broken.size()}), ulib::yaml::parse_error);
+}
+
+TEST(YamlUnicode, ValidatesUtf8)
+{
+    ulib::yaml::parse_options options;
+    options.validate_utf8 = true;
+
+    ASSERT_EQ(ulib::yaml::parse("a: caf\xC3\xA9 \xE2\x82\xAC \xF0\x9F\x98\x80", options)["a"].scalar(),
+              "caf\xC3\xA9 \xE2\x82\xAC \xF0\x9F\x98\x80");
+
+    // a stray continuation byte, an overlong '/', an encoded surrogate, past U+10FFFF and a cut off sequence
+    for (const char *bad : {"a: \x80", "a: \xC0\xAF", "a: \xED\xA0\x80", "a: \xF4\x90\x80\x80", "a: caf\xC3"})
+    {
+        SCOPED_TRACE(bad);
+        ASSERT_THROW(ulib::yaml::parse(bad, options), ulib::yaml::parse_error);
+
+        std::string json = std::string{"{\"a\": \""} + (bad + 3) + "\"}";
+        ASSERT_THROW(ulib::yaml::parse_json(json, options), ulib::yaml::parse_error);
+
+        options.lazy = true;
+        ASSERT_THROW(ulib::yaml::parse(bad, options), ulib::yaml::parse_error);
+        options.lazy = false;
+    }
+
+    // sequences split between chunks
+    ulib::yaml::stream_parser stream{options};
+    stream.feed("a: caf\xC3");
+    stream.feed("\xA9\nb: \xF0\x9F");
+    stream.feed("\x98\x80\n");
+    ASSERT_EQ(stream.finish()["b"].scalar(), "\xF0\x9F\x98\x80");
+
+    ulib::yaml::stream_parser cut{options};
+    cut.feed("a: \xE2\x82");
+    ASSERT_THROW(cut.finish(), ulib::yaml::parse_error);
+
+    ulib::yaml::stream_parser bad{options};
+    ASSERT_THROW(bad.feed("a: \xFF\n"), ulib::yaml::parse_error);
+}
+
+TEST(YamlUnicode, QuotedKeysAndWideStrings)
+{
+    // lazy parsing decodes quoted keys itself
+    ulib::yaml::parse_options lazy;
+    lazy.lazy = true;
+
+    const ulib::yaml yml = ulib::yaml::parse("\"caf\\u00e9\\t\\x41\": 1\n'it''s': 2\n\"\\U0001F600\": 3\n", lazy);
+    ASSERT_EQ(yml.items()[0].name(), "caf\xC3\xA9\tA");
+    ASSERT_EQ(yml.items()[1].name(), "it's");
+    ASSERT_EQ(yml.items()[2].name(), "\xF0\x9F\x98\x80");
+    ASSERT_EQ(yml, ulib::yaml::parse("\"caf\\u00e9\\t\\x41\": 1\n'it''s': 2\n\"\\U0001F600\": 3\n"));
+
+    // repeated wide reads come from the conversion cache and stay correct when the scalar changes
+    ulib::yaml node = ulib::yaml::parse("text: a scalar long enough to be cached");
+    ulib::u16string first = node["text"].get<ulib::u16string>();
+    ASSERT_EQ(node["text"].get<ulib::u16string>(), first);
+    ASSERT_EQ(first.size(), 33);
+
+    node["text"] = "another scalar long enough to be cached";
+    ASSERT_EQ(node["text"].get<ulib::u16string>().size(), 39);
+}